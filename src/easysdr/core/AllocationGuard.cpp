@@ -0,0 +1,193 @@
+//
+//  AllocationGuard.cpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#include "AllocationGuard.hpp"
+
+#include "Node.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+namespace SDR {
+
+namespace {
+// A plain pointer needs no dynamic initialization, so operator new may read
+// it from any thread at any time
+thread_local AllocationScope* currentScope = nullptr;
+} // namespace
+
+AllocationScope::AllocationScope(BaseNode& node, AllocationPolicy policy)
+    : node_(node), policy_(policy), outer_(currentScope) {
+  currentScope = this;
+}
+
+AllocationScope::~AllocationScope() {
+  currentScope = outer_;
+}
+
+AllocationScope* AllocationScope::current() {
+  return currentScope;
+}
+
+ForwardedAllocationScope::ForwardedAllocationScope(AllocationScope* scope)
+    : outer_(currentScope) {
+  currentScope = scope;
+}
+
+ForwardedAllocationScope::~ForwardedAllocationScope() {
+  currentScope = outer_;
+}
+
+bool AllocationScope::isEnabled() {
+#ifdef EASYSDR_ALLOCATION_GUARD
+  return true;
+#else
+  return false;
+#endif
+}
+
+void onAllocation() {
+  auto* scope = currentScope;
+  if (!scope) {
+    return;
+  }
+  switch (scope->policy_) {
+    case AllocationPolicy::None:
+      break;
+    case AllocationPolicy::Count:
+      scope->node_.counters().countAllocation();
+      break;
+    case AllocationPolicy::Abort:
+      // Reporting allocates as well
+      currentScope = nullptr;
+      std::cerr << "Heap allocation in process() of " << scope->node_.name()
+                << " after warm-up" << std::endl;
+      std::abort();
+  }
+}
+
+} // namespace SDR
+
+#ifdef EASYSDR_ALLOCATION_GUARD
+
+// Replacements of the global allocation functions. All of them allocate
+// with std::malloc() or std::aligned_alloc(), so that every variant of
+// operator delete frees with std::free().
+
+namespace {
+void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+  const auto align = static_cast<std::size_t>(alignment);
+  // std::aligned_alloc() takes multiples of the alignment only
+  const std::size_t rounded = ((size ? size : 1) + align - 1) & ~(align - 1);
+  return std::aligned_alloc(align, rounded);
+}
+} // namespace
+
+void* operator new(std::size_t size) {
+  SDR::onAllocation();
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  SDR::onAllocation();
+  return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  SDR::onAllocation();
+  if (void* ptr = allocateAligned(size, alignment)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void* operator new(
+    std::size_t size,
+    std::align_val_t alignment,
+    const std::nothrow_t&) noexcept {
+  SDR::onAllocation();
+  return allocateAligned(size, alignment);
+}
+
+void* operator new[](
+    std::size_t size,
+    std::align_val_t alignment,
+    const std::nothrow_t&) noexcept {
+  return operator new(size, alignment, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(
+    void* ptr,
+    std::align_val_t,
+    const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](
+    void* ptr,
+    std::align_val_t,
+    const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+#endif
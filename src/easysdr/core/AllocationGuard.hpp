@@ -0,0 +1,71 @@
+//
+//  AllocationGuard.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+namespace SDR {
+
+class BaseNode;
+
+// What happens to heap allocations made by process() once warm-up is over,
+// see Graph::guardAllocations()
+enum class AllocationPolicy {
+  // Allocations are not watched
+  None,
+  // Allocations are counted in the stats of the node making them
+  Count,
+  // The first allocation aborts the process, naming the node
+  Abort,
+};
+
+// Applies |policy| to the heap allocations the calling thread makes on
+// behalf of |node| while in scope. Only builds with EASYSDR_ALLOCATION_GUARD
+// hook operator new, over-aligned variants included, everywhere else scopes
+// do nothing. Threads helping with the work of a node, such as the shards of
+// ShardExecutor, are put in its scope with ForwardedAllocationScope.
+class AllocationScope final {
+ public:
+  AllocationScope(BaseNode& node, AllocationPolicy policy);
+  ~AllocationScope();
+
+  AllocationScope(const AllocationScope&) = delete;
+  AllocationScope& operator=(const AllocationScope&) = delete;
+
+  // Whether operator new is hooked in this build
+  static bool isEnabled();
+
+  // The innermost scope of the calling thread, nullptr outside of any
+  static AllocationScope* current();
+
+ private:
+  BaseNode& node_;
+  AllocationPolicy policy_;
+  AllocationScope* outer_;
+
+  friend void onAllocation();
+};
+
+// Puts the calling thread in |scope| of another thread while in scope, so
+// that allocations made on its behalf are charged to the same node. |scope|
+// may be nullptr and must outlive this object.
+class ForwardedAllocationScope final {
+ public:
+  explicit ForwardedAllocationScope(AllocationScope* scope);
+  ~ForwardedAllocationScope();
+
+  ForwardedAllocationScope(const ForwardedAllocationScope&) = delete;
+  ForwardedAllocationScope& operator=(const ForwardedAllocationScope&) =
+      delete;
+
+ private:
+  AllocationScope* outer_;
+};
+
+// Called by the hooked operator new
+void onAllocation();
+
+} // namespace SDR
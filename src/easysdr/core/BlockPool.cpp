@@ -0,0 +1,19 @@
+//
+//  BlockPool.cpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#include "BlockPool.hpp"
+
+namespace SDR {
+
+BlockPoolStats BlockPool::stats() const {
+  return BlockPoolStats{
+      .hits = counters_.hits.load(std::memory_order_relaxed),
+      .misses = counters_.misses.load(std::memory_order_relaxed),
+  };
+}
+
+} // namespace SDR
@@ -0,0 +1,161 @@
+//
+//  BlockPool.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+namespace SDR {
+
+template <typename T>
+struct BlockTraits {
+  constexpr static bool Poolable = false;
+};
+
+template <typename U, typename A>
+struct BlockTraits<std::vector<U, A>> {
+  constexpr static bool Poolable = true;
+  constexpr static size_t ElementSize = sizeof(U);
+
+  static size_t size(const std::vector<U, A>& block) {
+    return block.size();
+  }
+
+  static size_t capacity(const std::vector<U, A>& block) {
+    return block.capacity();
+  }
+
+  static void reserve(std::vector<U, A>& block, size_t capacity) {
+    block.reserve(capacity);
+  }
+
+  static void clear(std::vector<U, A>& block) {
+    block.clear();
+  }
+};
+
+struct BlockPoolStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+};
+
+struct BlockPoolCounters {
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+};
+
+class BaseBlockFreeList {
+ public:
+  virtual ~BaseBlockFreeList() {}
+};
+
+// Free list of recycled blocks of a single type. Not thread-safe: a free list
+// is only used by the subgraph thread owning the pool.
+template <typename T>
+class BlockFreeList final : public BaseBlockFreeList {
+ public:
+  using Traits = BlockTraits<T>;
+
+  BlockFreeList(BlockPoolCounters& counters, size_t maxBlocks)
+      : counters_(counters), maxBlocks_(maxBlocks) {
+    blocks_.reserve(maxBlocks);
+  }
+
+  T acquire(size_t capacity);
+  void release(T&& block);
+
+ private:
+  BlockPoolCounters& counters_;
+  const size_t maxBlocks_;
+  std::vector<T> blocks_;
+};
+
+// Per-subgraph pool of output blocks. Outputs return their previous block to
+// the pool on reset() and nodes acquire recycled blocks for new outputs, so
+// in steady state process() does not allocate.
+class BlockPool final {
+ public:
+  BlockPool(size_t maxBlocksPerType = 16)
+      : maxBlocksPerType_(maxBlocksPerType) {}
+
+  template <typename T>
+  BlockFreeList<T>& freeList();
+
+  BlockPoolStats stats() const;
+
+ private:
+  const size_t maxBlocksPerType_;
+  BlockPoolCounters counters_;
+  std::unordered_map<std::type_index, std::unique_ptr<BaseBlockFreeList>>
+      freeLists_;
+};
+
+template <typename T>
+T BlockFreeList<T>::acquire(size_t capacity) {
+  // Best fit: the smallest recycled block large enough for the request
+  auto best = blocks_.end();
+  for (auto it = blocks_.begin(); it != blocks_.end(); ++it) {
+    const size_t blockCapacity = Traits::capacity(*it);
+    if (blockCapacity >= capacity &&
+        (best == blocks_.end() || blockCapacity < Traits::capacity(*best))) {
+      best = it;
+    }
+  }
+
+  if (best == blocks_.end()) {
+    counters_.misses.fetch_add(1, std::memory_order_relaxed);
+    T block;
+    Traits::reserve(block, capacity);
+    return block;
+  }
+
+  counters_.hits.fetch_add(1, std::memory_order_relaxed);
+  T block = std::move(*best);
+  if (best != blocks_.end() - 1) {
+    *best = std::move(blocks_.back());
+  }
+  blocks_.pop_back();
+  return block;
+}
+
+template <typename T>
+void BlockFreeList<T>::release(T&& block) {
+  if (Traits::capacity(block) == 0) {
+    return;
+  }
+  if (blocks_.size() == maxBlocks_) {
+    // Keep the larger blocks around
+    auto smallest = blocks_.begin();
+    for (auto it = blocks_.begin(); it != blocks_.end(); ++it) {
+      if (Traits::capacity(*it) < Traits::capacity(*smallest)) {
+        smallest = it;
+      }
+    }
+    if (Traits::capacity(*smallest) >= Traits::capacity(block)) {
+      return;
+    }
+    blocks_.erase(smallest);
+  }
+  Traits::clear(block);
+  blocks_.push_back(std::move(block));
+}
+
+template <typename T>
+BlockFreeList<T>& BlockPool::freeList() {
+  auto& freeList = freeLists_[std::type_index(typeid(T))];
+  if (!freeList) {
+    freeList = std::make_unique<BlockFreeList<T>>(counters_, maxBlocksPerType_);
+  }
+  return static_cast<BlockFreeList<T>&>(*freeList);
+}
+
+} // namespace SDR
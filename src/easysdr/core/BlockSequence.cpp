@@ -0,0 +1,26 @@
+//
+//  BlockSequence.cpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#include "BlockSequence.hpp"
+
+namespace SDR {
+
+namespace {
+
+thread_local BlockSequence currentSequence = 0;
+
+} // namespace
+
+BlockSequence currentBlockSequence() {
+  return currentSequence;
+}
+
+void setCurrentBlockSequence(BlockSequence sequence) {
+  currentSequence = sequence;
+}
+
+} // namespace SDR
@@ -0,0 +1,29 @@
+//
+//  BlockSequence.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace SDR {
+
+// Source subgraphs number their iterations and queues carry the number along
+// with every block, so all blocks derived from the same input samples share a
+// sequence number no matter which subgraph processes them.
+using BlockSequence = uint64_t;
+
+// Blocks from queues which do not carry sequence numbers
+constexpr BlockSequence UnknownBlockSequence =
+    std::numeric_limits<BlockSequence>::max();
+
+// Sequence number of the block processed by the subgraph iteration running on
+// the calling thread
+BlockSequence currentBlockSequence();
+void setCurrentBlockSequence(BlockSequence sequence);
+
+} // namespace SDR
@@ -0,0 +1,89 @@
+//
+//  ControlMailbox.cpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#include "ControlMailbox.hpp"
+
+#include <iostream>
+#include <unordered_set>
+
+namespace SDR {
+
+ControlMailbox::~ControlMailbox() {
+  auto* message = head_.exchange(nullptr);
+  while (message) {
+    std::unique_ptr<ControlMessage> owned(message);
+    message = message->next;
+  }
+}
+
+void ControlMailbox::post(std::unique_ptr<ControlMessage> message) {
+  auto* raw = message.release();
+  raw->next = head_.load(std::memory_order_relaxed);
+  while (!head_.compare_exchange_weak(
+      raw->next, raw, std::memory_order_release, std::memory_order_relaxed)) {
+  }
+}
+
+void ControlMailbox::collect() {
+  auto* message = head_.exchange(nullptr, std::memory_order_acquire);
+  if (!message) {
+    return;
+  }
+  // The stack holds the latest message first
+  const size_t end = waiting_.size();
+  while (message) {
+    auto* next = message->next;
+    message->next = nullptr;
+    waiting_.emplace(waiting_.begin() + end, message);
+    message = next;
+  }
+}
+
+void ControlMailbox::apply(BlockSequence sequence) {
+  collect();
+
+  size_t ready = 0;
+  for (const auto& message : waiting_) {
+    auto& transaction = *message->transaction;
+    if (message->anchor &&
+        transaction.sequence.load(std::memory_order_relaxed) ==
+            ControlTransaction::Unassigned) {
+      transaction.sequence.store(sequence, std::memory_order_release);
+    }
+    const auto due = transaction.sequence.load(std::memory_order_acquire);
+    // Later transactions wait behind this one to keep the posting order
+    if (due == ControlTransaction::Unassigned || sequence < due) {
+      break;
+    }
+    ++ready;
+  }
+  if (ready == 0) {
+    return;
+  }
+
+  std::vector<const ControlUpdate*> latest;
+  std::unordered_set<const void*> keys;
+  for (size_t i = ready; i-- > 0;) {
+    const auto& updates = waiting_[i]->updates;
+    for (auto it = updates.rbegin(); it != updates.rend(); ++it) {
+      if (keys.insert(it->key).second) {
+        latest.push_back(&*it);
+      }
+    }
+  }
+  for (auto it = latest.rbegin(); it != latest.rend(); ++it) {
+    try {
+      (*it)->apply();
+    } catch (const std::exception& ex) {
+      std::cerr << "Exception setting control value: " << ex.what()
+                << std::endl;
+    }
+  }
+  waiting_.erase(waiting_.begin(), waiting_.begin() + ready);
+}
+
+} // namespace SDR
@@ -0,0 +1,86 @@
+//
+//  ControlMailbox.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include "BlockSequence.hpp"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace SDR {
+
+// Control updates posted together. Every subgraph involved applies its share
+// of the transaction right before processing the block the transaction was
+// assigned, so all of them switch over on the same samples.
+struct ControlTransaction {
+  constexpr static BlockSequence Unassigned = 0;
+
+  // Assigned by the anchor subgraph when it applies the transaction
+  std::atomic<BlockSequence> sequence{Unassigned};
+};
+
+struct ControlUpdate {
+  // Identifies the control, only the latest update for a key gets applied
+  const void* key;
+  std::function<void()> apply;
+};
+
+struct ControlMessage {
+  std::shared_ptr<ControlTransaction> transaction;
+  // The anchor assigns the transaction the sequence number of the block it
+  // is about to process, the other subgraphs wait for that block
+  bool anchor = false;
+  std::vector<ControlUpdate> updates;
+  ControlMessage* next = nullptr;
+};
+
+// Per-subgraph mailbox of control updates. Any thread may post, only the
+// subgraph itself takes messages out. Posting is a lock-free push onto a
+// stack, so the subgraph never locks to check for updates.
+class ControlMailbox final {
+ public:
+  ControlMailbox() {}
+  ~ControlMailbox();
+
+  ControlMailbox(const ControlMailbox&) = delete;
+  ControlMailbox& operator=(const ControlMailbox&) = delete;
+
+  void post(std::unique_ptr<ControlMessage> message);
+
+  // True if messages were posted since the subgraph last applied updates
+  bool hasPosted() const;
+
+  // True if no messages are posted or waiting for their block, subgraph
+  // side only
+  bool empty() const;
+
+  // Applies the transactions due at block |sequence| in the order they were
+  // posted, coalescing repeated updates of a control to the latest value
+  void apply(BlockSequence sequence);
+
+ private:
+  void collect();
+
+ private:
+  std::atomic<ControlMessage*> head_{nullptr};
+  // Collected messages waiting for their block, owned by the subgraph
+  std::deque<std::unique_ptr<ControlMessage>> waiting_;
+};
+
+inline bool ControlMailbox::hasPosted() const {
+  return head_.load(std::memory_order_acquire) != nullptr;
+}
+
+inline bool ControlMailbox::empty() const {
+  return !hasPosted() && waiting_.empty();
+}
+
+} // namespace SDR
@@ -0,0 +1,270 @@
+//
+//  Fused.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include "Node.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace SDR {
+
+// Stages of a Fused node are nodes producing one output sample for every
+// input sample, which besides process() implement:
+//
+//   using TileInput = ...;   // element types of the input and output blocks
+//   using TileOutput = ...;
+//   constexpr static bool Fusable = true;
+//   // Whether the stage needs to see its whole input block before it
+//   // produces any output, such as a gain computed from the block's peak
+//   constexpr static bool ScansBlock = ...;
+//   void beginBlock(size_t size);
+//   void scanBlock(const TileInput* in, size_t size);  // ScansBlock only
+//   void processTile(
+//       const TileInput* in, TileOutput* out, size_t offset, size_t count);
+//   void endBlock();
+//
+// processTile() gets the samples [offset, offset + count) of the block.
+template <class... Stages>
+struct FusedTraits {
+  static_assert(sizeof...(Stages) > 0, "no stages");
+  static_assert((Stages::Fusable && ...), "stage cannot be fused");
+
+  using StageTuple = std::tuple<Stages...>;
+
+  template <size_t Idx>
+  using StageAt = std::tuple_element_t<Idx, StageTuple>;
+
+  constexpr static size_t StageCount = sizeof...(Stages);
+
+  using Input = typename StageAt<0>::TileInput;
+  using Output = typename StageAt<StageCount - 1>::TileOutput;
+
+  template <size_t... Idx>
+  constexpr static bool chained(std::index_sequence<Idx...>) {
+    return (std::is_same_v<
+                typename StageAt<Idx>::TileOutput,
+                typename StageAt<Idx + 1>::TileInput> &&
+            ...);
+  }
+
+  static_assert(
+      chained(std::make_index_sequence<StageCount - 1>()),
+      "stage output does not match the input of the next stage");
+};
+
+// Runs a chain of per-sample stages as a single node. Instead of every stage
+// writing a full block the next one reads back, the chain runs over tiles of
+// TileSize samples which stay in cache from one stage to the next, and the
+// graph makes one process() call instead of one per stage. Blocks are only
+// materialized in front of stages scanning them, see FusedTraits.
+//
+// Stages are owned by the fused node and are not in the graph. Their
+// controls may still be bound with Graph::bind() through stage(), updates
+// are applied by the subgraph of the fused node.
+template <class... Stages>
+class Fused final
+    : public Node<
+          Input<std::vector<typename FusedTraits<Stages...>::Input>>,
+          Output<std::vector<typename FusedTraits<Stages...>::Output>>> {
+ public:
+  using Traits = FusedTraits<Stages...>;
+
+  template <size_t Idx>
+  using StageAt = typename Traits::template StageAt<Idx>;
+
+  constexpr static size_t StageCount = Traits::StageCount;
+  constexpr static size_t TileSize = 1024;
+
+  // Default-constructs every stage
+  Fused();
+
+  // Constructs every stage from the corresponding tuple of arguments
+  template <class... ArgTuples>
+  explicit Fused(ArgTuples&&... args);
+
+  enum { IN_INPUT = 0, OUT_OUTPUT };
+
+  virtual void init() override;
+  virtual void process() override;
+  virtual void destroy() override;
+
+  template <size_t Idx>
+  StageAt<Idx>& stage();
+
+  template <size_t Idx>
+  const StageAt<Idx>& stage() const;
+
+ private:
+  // One past the last stage of the tile loop starting at stage |first|,
+  // which runs up to the next stage scanning its block
+  constexpr static size_t segmentEnd(size_t first);
+
+  template <class Stage, class ArgTuple>
+  static std::unique_ptr<Stage> makeStage(ArgTuple&& args);
+
+  void setEnclosingNode();
+
+  template <size_t First>
+  void runSegment(
+      const typename StageAt<First>::TileInput* in,
+      typename Traits::Output* out,
+      size_t size);
+
+  template <size_t Idx, size_t Last>
+  void runTile(
+      const typename StageAt<Idx>::TileInput* in,
+      typename Traits::Output* out,
+      size_t offset,
+      size_t count);
+
+ private:
+  // Nodes can be neither copied nor moved
+  std::tuple<std::unique_ptr<Stages>...> stages_;
+  // Output of every stage but the last, a tile or a whole block when the
+  // next stage scans its block. Kept across blocks so that process() only
+  // allocates when blocks grow.
+  std::tuple<std::vector<typename Stages::TileOutput>...> buffers_;
+};
+
+template <class... Stages>
+Fused<Stages...>::Fused() : stages_(std::make_unique<Stages>()...) {
+  setEnclosingNode();
+}
+
+template <class... Stages>
+template <class... ArgTuples>
+Fused<Stages...>::Fused(ArgTuples&&... args)
+    : stages_(makeStage<Stages>(std::forward<ArgTuples>(args))...) {
+  setEnclosingNode();
+}
+
+template <class... Stages>
+void Fused<Stages...>::init() {
+  std::apply(
+      [](auto&... buffer) { (buffer.resize(TileSize), ...); }, buffers_);
+  std::apply([](auto&... stage) { (stage->init(), ...); }, stages_);
+}
+
+template <class... Stages>
+void Fused<Stages...>::process() {
+  auto& inData = this->template getData<IN_INPUT>();
+  const size_t size = inData.size();
+
+  auto outData = this->template acquireData<OUT_OUTPUT>(size);
+  outData.resize(size);
+
+  std::apply(
+      [size](auto&... stage) { (stage->beginBlock(size), ...); }, stages_);
+  runSegment<0>(inData.data(), outData.data(), size);
+  std::apply([](auto&... stage) { (stage->endBlock(), ...); }, stages_);
+
+  this->template setData<OUT_OUTPUT>(std::move(outData));
+}
+
+template <class... Stages>
+void Fused<Stages...>::destroy() {
+  std::apply([](auto&... stage) { (stage->destroy(), ...); }, stages_);
+}
+
+template <class... Stages>
+template <size_t Idx>
+typename Fused<Stages...>::template StageAt<Idx>& Fused<Stages...>::stage() {
+  return *std::get<Idx>(stages_);
+}
+
+template <class... Stages>
+template <size_t Idx>
+const typename Fused<Stages...>::template StageAt<Idx>&
+Fused<Stages...>::stage() const {
+  return *std::get<Idx>(stages_);
+}
+
+template <class... Stages>
+constexpr size_t Fused<Stages...>::segmentEnd(size_t first) {
+  constexpr bool scansBlock[] = {Stages::ScansBlock...};
+  size_t idx = first + 1;
+  while (idx < StageCount && !scansBlock[idx]) {
+    ++idx;
+  }
+  return idx;
+}
+
+template <class... Stages>
+template <class Stage, class ArgTuple>
+std::unique_ptr<Stage> Fused<Stages...>::makeStage(ArgTuple&& args) {
+  return std::apply(
+      [](auto&&... arg) {
+        return std::make_unique<Stage>(std::forward<decltype(arg)>(arg)...);
+      },
+      std::forward<ArgTuple>(args));
+}
+
+template <class... Stages>
+void Fused<Stages...>::setEnclosingNode() {
+  std::apply(
+      [this](auto&... stage) { (stage->setEnclosingNode(this), ...); },
+      stages_);
+}
+
+template <class... Stages>
+template <size_t First>
+void Fused<Stages...>::runSegment(
+    const typename StageAt<First>::TileInput* in,
+    typename Traits::Output* out,
+    size_t size) {
+  constexpr size_t Last = segmentEnd(First);
+  if constexpr (Last < StageCount) {
+    auto& block = std::get<Last - 1>(buffers_);
+    if (block.size() < size) {
+      block.resize(size);
+    }
+  }
+
+  if constexpr (StageAt<First>::ScansBlock) {
+    stage<First>().scanBlock(in, size);
+  }
+  for (size_t offset = 0; offset < size; offset += TileSize) {
+    const size_t count = std::min(TileSize, size - offset);
+    runTile<First, Last>(in + offset, out, offset, count);
+  }
+
+  if constexpr (Last < StageCount) {
+    runSegment<Last>(std::get<Last - 1>(buffers_).data(), out, size);
+  }
+}
+
+template <class... Stages>
+template <size_t Idx, size_t Last>
+void Fused<Stages...>::runTile(
+    const typename StageAt<Idx>::TileInput* in,
+    typename Traits::Output* out,
+    size_t offset,
+    size_t count) {
+  if constexpr (Idx + 1 == Last) {
+    // The last stage of the segment writes the output block, or the block
+    // the next segment scans
+    typename StageAt<Idx>::TileOutput* tileOut;
+    if constexpr (Last == StageCount) {
+      tileOut = out + offset;
+    } else {
+      tileOut = std::get<Idx>(buffers_).data() + offset;
+    }
+    stage<Idx>().processTile(in, tileOut, offset, count);
+  } else {
+    auto* tile = std::get<Idx>(buffers_).data();
+    stage<Idx>().processTile(in, tile, offset, count);
+    runTile<Idx + 1, Last>(tile, out, offset, count);
+  }
+}
+
+} // namespace SDR
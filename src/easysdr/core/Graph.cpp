@@ -9,8 +9,12 @@
 
 #include "Node.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
+#include <iterator>
+#include <set>
+#include <tuple>
 
 namespace SDR {
 
@@ -22,15 +26,13 @@ void Graph::addNodeToSubgraph(BaseNode* node, Subgraph* sub) {
   }
   sub->nodes.insert(node);
   nodeToSubgraph_[node] = sub;
+  nodeOrder_.emplace(node, nextNodeOrder_++);
 }
 
 void Graph::mergeSubgraphs(Subgraph* sub0, Subgraph* sub1) {
   if (sub0 == sub1) {
     return;
   }
-  if (sub0->inQueue && sub1->inQueue) {
-    throw std::runtime_error("bad topology");
-  }
   // TODO handle additional "bad topology" scenarios:
   // 1. looping back to SDR input thread
   // 2. attempting to directly connect subgraphs which are already connected via
@@ -40,10 +42,14 @@ void Graph::mergeSubgraphs(Subgraph* sub0, Subgraph* sub1) {
   }
   sub0->nodes.merge(sub1->nodes);
   sub0->edges.merge(sub1->edges);
-  if (sub1->inQueue) {
-    sub0->inQueue = std::move(sub1->inQueue);
-  }
-  subgraphs_.erase(std::shared_ptr<Subgraph>(sub1, [](auto) {}));
+  std::move(
+      sub1->inQueues.begin(),
+      sub1->inQueues.end(),
+      std::back_inserter(sub0->inQueues));
+  subgraphs_.erase(std::find_if(
+      subgraphs_.begin(), subgraphs_.end(), [sub1](const auto& sub) {
+        return sub.get() == sub1;
+      }));
 }
 
 void Graph::ensureSameSubgraph(BaseNode* node0, BaseNode* node1) {
@@ -78,8 +84,16 @@ void Graph::ensureDisconnectedSubgraphs(BaseNode* node0, BaseNode* node1) {
 }
 
 std::vector<BaseNode*> Graph::topologicalSort(const Subgraph& topology) {
+  // Ready nodes are taken in the order they were added to the graph
+  struct ByNodeOrder {
+    const std::unordered_map<const BaseNode*, size_t>& nodeOrder;
+    bool operator()(const BaseNode* node0, const BaseNode* node1) const {
+      return nodeOrder.at(node0) < nodeOrder.at(node1);
+    }
+  };
+
   std::vector<BaseNode*> orderedNodes;
-  std::unordered_set<BaseNode*> currentNodes;
+  std::set<BaseNode*, ByNodeOrder> currentNodes(ByNodeOrder{nodeOrder_});
   std::unordered_map<BaseNode*, size_t> edgeCounts;
 
   for (auto pair : topology.edges) {
@@ -119,148 +133,1235 @@ std::vector<BaseNode*> Graph::topologicalSort(const Subgraph& topology) {
   return orderedNodes;
 }
 
+Graph::Schedule Graph::compileSchedule(const Subgraph& topology) {
+  Schedule schedule;
+  for (auto node : topologicalSort(topology)) {
+    const auto priority = nodePriorities_.find(node);
+    schedule.push_back(ScheduleStep{
+        .node = node,
+        .reset = node->needsReset(),
+        .priority = priority != nodePriorities_.end() ? priority->second
+                                                       : NodePriority::RealTime,
+    });
+  }
+  return schedule;
+}
+
+Graph::Subgraph* Graph::findSource(Subgraph* topology) {
+  // Queued edges never form a cycle, so walking upstream ends at a subgraph
+  // without an input queue
+  for (size_t i = 0; i < subgraphs_.size(); ++i) {
+    if (topology->inQueues.empty()) {
+      return topology;
+    }
+    topology = findSubgraph(topology->inQueues.front().producer);
+  }
+  throw std::runtime_error("cycle topology");
+}
+
+void Graph::partition(const PartitionOptions& options) {
+  if (partitioned_) {
+    return;
+  }
+  partitioned_ = true;
+
+  // Nodes sharing a name are numbered the same way in graphs assembled the
+  // same way, so measured costs carry over by name
+  std::unordered_map<std::string, double> measured;
+  if (options.measured) {
+    const auto uptime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            options.measured->uptime)
+                            .count();
+    for (const auto& node : options.measured->nodes) {
+      if (uptime > 0) {
+        measured[node.name] = static_cast<double>(node.processNanos) /
+            static_cast<double>(uptime);
+      }
+    }
+  }
+  const auto names = nodeNames();
+  const auto cost = [&](const BaseNode* node) {
+    if (const auto name = names.find(node); name != names.end()) {
+      if (const auto found = measured.find(name->second);
+          found != measured.end()) {
+        return found->second;
+      }
+    }
+    const auto declared = nodeCosts_.find(node);
+    return declared != nodeCosts_.end() ? declared->second : 0.;
+  };
+  const size_t maxStages = options.maxStages
+      ? options.maxStages
+      : ThreadPool::shared().threadCount();
+
+  // Source subgraphs block in their input node, only the subgraphs behind a
+  // queue can be split
+  std::vector<Subgraph*> subgraphs;
+  for (const auto& t : subgraphs_) {
+    if (!t->inQueues.empty()) {
+      subgraphs.push_back(t.get());
+    }
+  }
+  for (auto sub : subgraphs) {
+    partitionSubgraph(sub, cost, maxStages, options);
+  }
+}
+
+void Graph::partitionSubgraph(
+    Subgraph* sub,
+    const std::function<double(const BaseNode*)>& cost,
+    size_t maxStages,
+    const PartitionOptions& options) {
+  std::unordered_set<const BaseNode*> queueNodes;
+  for (const auto& node : extraNodes_) {
+    queueNodes.insert(node.get());
+  }
+  std::unordered_set<const BaseNode*> fed;
+  for (const auto& pair : sub->edges) {
+    fed.insert(pair.second.begin(), pair.second.end());
+  }
+
+  Pipeline pipeline;
+  pipeline.subgraphs.push_back(sub);
+  pipeline.queueOptions = options.queue;
+  std::unordered_map<const BaseNode*, size_t> positions;
+  for (const auto node : topologicalSort(*sub)) {
+    if (queueNodes.count(node)) {
+      continue;
+    }
+    // A node producing data on its own would leave its stage without a queue
+    if (!fed.count(node)) {
+      return;
+    }
+    positions[node] = pipeline.nodes.size();
+    pipeline.nodes.push_back(node);
+  }
+  const size_t count = pipeline.nodes.size();
+  if (count < 2) {
+    return;
+  }
+
+  // Stage boundary i lies right before the node at position i. The input
+  // queues of the subgraph all feed the first stage, and the edges across a
+  // boundary must all start from a single output that can be queued.
+  size_t firstCut = 1;
+  for (const auto& input : sub->inQueues) {
+    const auto consumer = positions.find(input.consumer);
+    if (consumer == positions.end()) {
+      return;
+    }
+    firstCut = std::max(firstCut, consumer->second + 1);
+  }
+  pipeline.cuts.assign(count, false);
+  std::vector<const void*> ports(count, nullptr);
+  for (size_t i = firstCut; i < count; ++i) {
+    pipeline.cuts[i] = true;
+  }
+  const auto cross = [&](size_t from, size_t to, const void* port) {
+    for (size_t i = from + 1; i <= to; ++i) {
+      if (!port || (ports[i] && ports[i] != port)) {
+        pipeline.cuts[i] = false;
+      }
+      ports[i] = port;
+    }
+  };
+  std::set<std::pair<const BaseNode*, const BaseNode*>> linked;
+  for (auto& link : links_) {
+    const auto from = positions.find(link.from);
+    const auto to = positions.find(link.to);
+    if (from != positions.end() && to != positions.end()) {
+      linked.emplace(link.from, link.to);
+      pipeline.links.push_back(&link);
+      cross(from->second, to->second, link.port);
+    }
+  }
+  for (const auto& pair : sub->edges) {
+    for (const auto to : pair.second) {
+      if (positions.count(pair.first) && positions.count(to) &&
+          !linked.count({pair.first, to})) {
+        cross(positions.at(pair.first), positions.at(to), nullptr);
+      }
+    }
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (!ports[i]) {
+      pipeline.cuts[i] = false;
+    }
+  }
+
+  std::vector<double> costs;
+  for (const auto node : pipeline.nodes) {
+    costs.push_back(cost(node));
+  }
+  const auto stages =
+      partitionStages(costs, pipeline.cuts, maxStages, options.minStageCost);
+  if (stages.back() == 0) {
+    return;
+  }
+  pipeline.stages.assign(count, 0);
+  reshapePipeline(pipeline, stages);
+  pipelines_.push_back(std::move(pipeline));
+}
+
+void Graph::reshapePipeline(
+    Pipeline& pipeline,
+    const std::vector<size_t>& stages) {
+  const size_t stageCount = stages.back() + 1;
+  while (pipeline.subgraphs.size() < stageCount) {
+    pipeline.subgraphs.push_back(createSubgraph());
+  }
+
+  std::unordered_map<const BaseNode*, size_t> positions;
+  for (size_t i = 0; i < pipeline.nodes.size(); ++i) {
+    positions[pipeline.nodes[i]] = i;
+  }
+  const auto stageOf = [&](const BaseNode* node) {
+    return stages[positions.at(node)];
+  };
+
+  // Edges which end up within a stage leave their queues
+  std::vector<Link*> unqueued;
+  for (auto link : pipeline.links) {
+    if (link->queueIn && stageOf(link->from) == stageOf(link->to)) {
+      link->unqueue(*link);
+      unqueued.push_back(link);
+    }
+  }
+
+  // Queue nodes stay with the node on the other end of their edge
+  std::unordered_set<const BaseNode*> queueNodes;
+  for (const auto& node : extraNodes_) {
+    queueNodes.insert(node.get());
+  }
+  std::unordered_map<const BaseNode*, const BaseNode*> attachedTo;
+  std::unordered_set<BaseNode*> nodes;
+  std::vector<std::pair<BaseNode*, BaseNode*>> edges;
+  std::vector<InputQueue> inQueues;
+  for (auto sub : pipeline.subgraphs) {
+    for (const auto& pair : sub->edges) {
+      for (const auto to : pair.second) {
+        edges.emplace_back(pair.first, to);
+        if (queueNodes.count(pair.first)) {
+          attachedTo[pair.first] = to;
+        } else if (queueNodes.count(to)) {
+          attachedTo[to] = pair.first;
+        }
+      }
+    }
+    nodes.merge(sub->nodes);
+    std::move(
+        sub->inQueues.begin(),
+        sub->inQueues.end(),
+        std::back_inserter(inQueues));
+    sub->nodes.clear();
+    sub->edges.clear();
+    sub->inQueues.clear();
+  }
+  for (auto link : unqueued) {
+    edges.emplace_back(link->from, link->to);
+  }
+  const auto subgraphOf = [&](const BaseNode* node) {
+    const auto attached = attachedTo.find(node);
+    return pipeline.subgraphs[stageOf(
+        attached != attachedTo.end() ? attached->second : node)];
+  };
+
+  for (const auto node : nodes) {
+    auto sub = subgraphOf(node);
+    sub->nodes.insert(node);
+    nodeToSubgraph_[node] = sub;
+  }
+  // Edges across stages are left out, they are about to be queued
+  for (const auto& edge : edges) {
+    const auto sub = subgraphOf(edge.first);
+    if (sub == subgraphOf(edge.second)) {
+      sub->edges[edge.first].insert(edge.second);
+    }
+  }
+  for (auto& input : inQueues) {
+    subgraphOf(input.consumer)->inQueues.push_back(std::move(input));
+  }
+
+  for (auto link : pipeline.links) {
+    if (!link->queueIn && stageOf(link->from) != stageOf(link->to)) {
+      link->queue(*link, pipeline.queueOptions);
+    }
+  }
+
+  // All queues into a stage carry the blocks of the same output, the stage
+  // takes them together
+  for (size_t stage = 1; stage < stageCount; ++stage) {
+    auto sub = pipeline.subgraphs[stage];
+    if (sub->inQueues.size() > 1) {
+      sub->readiness = InputReadiness::AllAligned;
+      inputReadiness_[sub->inQueues.front().consumer] =
+          InputReadiness::AllAligned;
+    }
+  }
+  pipeline.stages = stages;
+}
+
+void Graph::removeQueueNodes(Link& link) {
+  {
+    // Queue nodes added later may get the same addresses, and would be taken
+    // as pruned already
+    std::lock_guard<std::mutex> lock(demandMutex_);
+    std::vector<BaseOutput*> ports;
+    for (const auto node : {link.queueIn, link.queueOut}) {
+      prunedNodes_.erase(node);
+      node->collectOutputs(ports);
+    }
+    for (auto port : ports) {
+      undemandedOutputs_.erase(port);
+    }
+  }
+
+  auto sub = findSubgraph(link.queueIn);
+  sub->inQueues.erase(std::find_if(
+      sub->inQueues.begin(), sub->inQueues.end(), [&link](const auto& input) {
+        return input.queue.get() == link.inQueue;
+      }));
+  for (const auto node : {link.queueIn, link.queueOut}) {
+    auto owner = findSubgraph(node);
+    owner->nodes.erase(node);
+    owner->edges.erase(node);
+    for (auto& pair : owner->edges) {
+      pair.second.erase(node);
+    }
+    nodeToSubgraph_.erase(node);
+    nodeOrder_.erase(node);
+    extraNodes_.erase(std::find_if(
+        extraNodes_.begin(), extraNodes_.end(), [node](const auto& extra) {
+          return extra.get() == node;
+        }));
+  }
+  link.queueIn = nullptr;
+  link.queueOut = nullptr;
+  link.inQueue = nullptr;
+}
+
 void Graph::startRunning() {
   assert(!subgraphs_.empty());
-  initLatch_.reset(subgraphs_.size());
+  for (auto& t : subgraphs_) {
+    t->threadConfig = ThreadConfig{};
+  }
+  for (const auto& pair : threadConfigs_) {
+    const auto sub = findSubgraph(pair.first);
+    if (!sub) {
+      throw std::runtime_error("node not in graph");
+    }
+    if (isPooled(*sub)) {
+      std::cerr << "Thread config of " << pair.first->name()
+                << " ignored, its subgraph runs on the thread pool"
+                << std::endl;
+      continue;
+    }
+    sub->threadConfig = pair.second;
+  }
+  for (auto& t : subgraphs_) {
+    t->readiness = InputReadiness::Any;
+  }
+  for (const auto& pair : inputReadiness_) {
+    const auto sub = findSubgraph(pair.first);
+    if (!sub) {
+      throw std::runtime_error("node not in graph");
+    }
+    sub->readiness = pair.second;
+  }
+
+  if (sharding_ && !shardExecutor_) {
+    shardExecutor_ =
+        std::make_unique<ShardExecutor>(ThreadPool::shared(), shardOptions_);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(demandMutex_);
+    prunedNodes_.clear();
+    undemandedOutputs_.clear();
+  }
+
   stopping_ = false;
+  startTime_ = std::chrono::steady_clock::now();
+  backloggedSubgraphs_ = 0;
   for (auto& t : subgraphs_) {
-    t->actions = std::make_unique<ControlActions>();
-    threads_.emplace_back([this, t]() { runner(*t); });
+    t->backlogged = false;
+    t->controls = std::make_unique<ControlMailbox>();
+    t->notifier = std::make_unique<Notifier>();
+    t->pool = std::make_unique<BlockPool>();
+    for (auto node : t->nodes) {
+      node->counters().clear();
+      if (node->isShardable()) {
+        node->setShardExecutor(shardExecutor_.get());
+      }
+    }
+    t->schedule = compileSchedule(*t);
+    t->source = findSource(t.get());
+    for (auto& input : t->inQueues) {
+      input.counters = std::make_unique<QueueCounters>();
+    }
+    attachInputQueues(*t);
+    if (isPooled(*t)) {
+      // No iterations get scheduled until all subgraph threads are running
+      t->poolTask = std::make_unique<PoolTask>(*t);
+      t->poolTask->scheduled = true;
+      t->notifier->setCallback(
+          [this, task = t->poolTask.get()]() { scheduleIteration(*task); });
+    }
   }
-  initLatch_.wait();
+
+  initAllNodes();
+
+  for (auto& t : subgraphs_) {
+    if (!t->poolTask) {
+      threads_.emplace_back([this, t]() { runner(*t); });
+    }
+  }
+  for (auto& t : subgraphs_) {
+    if (t->poolTask) {
+      t->poolTask->scheduled = false;
+      scheduleIteration(*t->poolTask);
+    }
+  }
+
+  if (rebalancing_ && executionMode_ == ExecutionMode::ThreadPool &&
+      !pipelines_.empty()) {
+    for (auto& pipeline : pipelines_) {
+      pipeline.processNanos.assign(pipeline.nodes.size(), 0);
+      pipeline.measuredAt = startTime_;
+    }
+    rebalancer_ = std::thread([this]() { rebalancer(); });
+  }
+
+  refreshDemand();
 }
 
 void Graph::stopRunning() {
   destroyLatch_.reset(subgraphs_.size());
   stopping_ = true;
+
+  if (rebalancer_.joinable()) {
+    // Orders the flag with the rebalancer checking it before it waits
+    { std::lock_guard<std::mutex> lock(rebalancerMutex_); }
+    rebalancerCondition_.notify_all();
+    rebalancer_.join();
+  }
+
+  for (auto& t : subgraphs_) {
+    // Wake up subgraph threads waiting for data
+    t->notifier->notify();
+  }
+
+  for (auto& t : subgraphs_) {
+    if (t->poolTask) {
+      pauseIteration(*t->poolTask);
+      destroyLatch_.arrive();
+    }
+  }
   destroyLatch_.wait();
+
+  for (auto& t : subgraphs_) {
+    if (t->poolTask) {
+      destroyNodes(t->schedule);
+    }
+  }
   for (auto& thread : threads_) {
     thread.join();
   }
   threads_.clear();
+
+  // Producers are all stopped, nothing notifies anymore
+  for (auto& t : subgraphs_) {
+    for (auto& input : t->inQueues) {
+      input.queue->setNotifier(nullptr);
+    }
+    t->poolTask.reset();
+  }
 }
 
-void Graph::runner(const Subgraph& topology) {
-  const auto orderedNodes = topologicalSort(topology);
+void Graph::attachInputQueues(Subgraph& topology) {
+  for (auto& input : topology.inQueues) {
+    input.source = findSource(findSubgraph(input.producer));
+    input.queue->setHeld(false);
+    input.queue->setNotifier(topology.notifier.get());
+  }
+}
+
+void Graph::pauseIteration(PoolTask& task) {
+  // Keeps new iterations from being scheduled and waits for the ones in
+  // flight to return. Every iteration clears the flag before it returns.
+  std::unique_lock<std::mutex> lock(task.mutex);
+  task.returned.wait(lock, [&task] { return !task.scheduled.exchange(true); });
+  task.returned.wait(lock, [&task] { return task.active == 0; });
+}
+
+void Graph::rebalancer() {
+  std::unique_lock<std::mutex> lock(rebalancerMutex_);
+  const auto stopping = [this]() { return stopping_.load(); };
+  while (!rebalancerCondition_.wait_for(
+      lock, rebalanceOptions_.interval, stopping)) {
+    for (auto& pipeline : pipelines_) {
+      rebalance(pipeline);
+    }
+  }
+}
+
+void Graph::rebalance(Pipeline& pipeline) {
+  const auto now = std::chrono::steady_clock::now();
+  const double elapsed =
+      std::chrono::duration<double, std::nano>(now - pipeline.measuredAt)
+          .count();
+  std::vector<double> costs;
+  for (size_t i = 0; i < pipeline.nodes.size(); ++i) {
+    NodeStats stats;
+    pipeline.nodes[i]->counters().snapshot(stats);
+    costs.push_back(
+        elapsed > 0.
+            ? static_cast<double>(
+                  stats.processNanos - pipeline.processNanos[i]) /
+                elapsed
+            : 0.);
+    pipeline.processNanos[i] = stats.processNanos;
+  }
+  pipeline.measuredAt = now;
+
+  const double current = maxStageCost(costs, pipeline.stages);
+  const auto stages =
+      balanceStages(costs, pipeline.cuts, pipeline.subgraphs.size());
+  if (current <= 0. || stages.empty() || stages == pipeline.stages) {
+    return;
+  }
+  const double balanced = maxStageCost(costs, stages);
+  if (balanced > current * (1. - rebalanceOptions_.minImprovement)) {
+    return;
+  }
+  if (migrate(pipeline, stages)) {
+    rebalances_.fetch_add(1, std::memory_order_relaxed);
+    // Queue nodes added by the move follow the pruning of their branch
+    refreshDemand();
+  }
+}
+
+bool Graph::migrate(Pipeline& pipeline, const std::vector<size_t>& stages) {
+  // Blocks arriving at the first stage wait in its input queues while the
+  // stages are paused
+  const auto& entry = *pipeline.subgraphs.front();
+  const auto entryDrops = [&entry]() {
+    uint64_t drops = 0;
+    for (const auto& input : entry.inQueues) {
+      drops += input.queue->drops();
+    }
+    return drops;
+  };
+  const auto entryBacklogged = [this, &entry]() {
+    return std::any_of(
+        entry.inQueues.begin(), entry.inQueues.end(), [this](const auto& in) {
+          return static_cast<double>(in.queue->size()) >
+              rebalanceOptions_.maxBacklog *
+              static_cast<double>(in.queue->capacity());
+        });
+  };
+  const uint64_t dropsBefore = entryDrops();
+
+  for (auto sub : pipeline.subgraphs) {
+    pauseIteration(*sub->poolTask);
+  }
+
+  // Blocks between the stages are processed where they are
+  for (bool progress = true; progress && !stopping_ && !entryBacklogged();) {
+    progress = false;
+    for (size_t stage = 1; stage < pipeline.subgraphs.size(); ++stage) {
+      const auto& topology = *pipeline.subgraphs[stage];
+      try {
+        BlockSequence sequence;
+        if (hasData(topology) && prepareInputs(topology, sequence)) {
+          topology.controls->apply(sequence);
+          processNodes(topology, sequence);
+          progress = true;
+        }
+      } catch (const std::exception& ex) {
+        std::cerr << "Graph node exception in process(): " << ex.what()
+                  << std::endl;
+      }
+    }
+  }
+
+  bool drained = true;
+  for (size_t stage = 1; stage < pipeline.subgraphs.size(); ++stage) {
+    for (const auto& input : pipeline.subgraphs[stage]->inQueues) {
+      drained = drained && input.queue->size() == 0;
+    }
+  }
+
+  bool moved = false;
+  {
+    std::unique_lock<std::shared_mutex> lock(topologyMutex_);
+    // Control updates waiting for their block would be applied by the wrong
+    // stage, nodes move once they are through
+    const bool idle = std::all_of(
+        pipeline.subgraphs.begin(),
+        pipeline.subgraphs.end(),
+        [](const auto sub) { return sub->controls->empty(); });
+    if (drained && idle && !stopping_ && !entryBacklogged()) {
+      reshapePipeline(pipeline, stages);
+      for (auto sub : pipeline.subgraphs) {
+        sub->schedule = compileSchedule(*sub);
+        sub->source = findSource(sub);
+        for (auto& input : sub->inQueues) {
+          if (!input.counters) {
+            input.counters = std::make_unique<QueueCounters>();
+          }
+        }
+        attachInputQueues(*sub);
+        for (const auto& step : sub->schedule) {
+          step.node->setBlockPool(sub->pool.get());
+        }
+      }
+      moved = true;
+    }
+  }
+
+  for (auto sub : pipeline.subgraphs) {
+    sub->poolTask->scheduled = false;
+    scheduleIteration(*sub->poolTask);
+  }
+  rebalanceDrops_.fetch_add(
+      entryDrops() - dropsBefore, std::memory_order_relaxed);
+  return moved;
+}
 
-  initNodes(orderedNodes);
+void Graph::runner(const Subgraph& topology) {
+  applyThreadConfig(topology.threadConfig);
 
+  BlockSequence sourceSequence = ControlTransaction::Unassigned;
   while (!stopping_) {
     try {
-      runActions(topology);
-      if (!waitForData(topology)) {
+      if (!hasData(topology)) {
+        // Control updates wait for the block they are due at
+        topology.notifier->wait();
         continue;
       }
-      for (auto node : orderedNodes) {
-        node->reset();
-      }
-      for (auto node : orderedNodes) {
-        node->process();
+      BlockSequence sequence;
+      if (topology.inQueues.empty()) {
+        sequence = ++sourceSequence;
+      } else if (!prepareInputs(topology, sequence)) {
+        continue;
       }
+      topology.controls->apply(sequence);
+      processNodes(topology, sequence);
     } catch (const std::exception& ex) {
       std::cerr << "Graph node exception in process(): " << ex.what()
                 << std::endl;
     }
   }
 
-  destroyNodes(orderedNodes);
+  destroyLatch_.arrive_and_wait();
+  destroyNodes(topology.schedule);
 }
 
-void Graph::initNodes(const std::vector<BaseNode*>& nodes) {
-  for (auto node : nodes) {
+void Graph::scheduleIteration(PoolTask& task) {
+  if (stopping_ || task.scheduled.exchange(true)) {
+    return;
+  }
+  ++task.active;
+  ThreadPool::shared().submit([this, &task]() {
+    runIteration(task);
+    // Under the lock, so that pauseIteration() cannot return and the task
+    // cannot go away before the notification is out
+    std::lock_guard<std::mutex> lock(task.mutex);
+    --task.active;
+    task.returned.notify_all();
+  });
+}
+
+void Graph::runIteration(PoolTask& task) {
+  const auto& topology = task.topology;
+  if (!stopping_) {
     try {
-      node->init();
+      BlockSequence sequence;
+      if (hasData(topology) && prepareInputs(topology, sequence)) {
+        topology.controls->apply(sequence);
+        processNodes(topology, sequence);
+      }
     } catch (const std::exception& ex) {
-      std::cerr << "Graph node exception in init(): " << ex.what() << std::endl;
+      std::cerr << "Graph node exception in process(): " << ex.what()
+                << std::endl;
     }
   }
-  initLatch_.arrive_and_wait();
+
+  task.scheduled.store(false);
+  // Notifications dropped while the iteration was scheduled: either the
+  // notifier sees the cleared flag, or we see its block here. Control updates
+  // are only applied along with a block, so they do not need a check.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!stopping_ && hasData(topology)) {
+    scheduleIteration(task);
+  }
 }
 
-void Graph::destroyNodes(const std::vector<BaseNode*>& nodes) {
-  destroyLatch_.arrive_and_wait();
-  for (auto node : nodes) {
+void Graph::processNodes(const Subgraph& topology, BlockSequence sequence) {
+  // Queue outputs tag the blocks they push with it
+  setCurrentBlockSequence(sequence);
+  for (const auto& input : topology.inQueues) {
+    input.counters->sample(input.queue->size());
+  }
+  const auto allocationPolicy =
+      allocationPolicy_.load(std::memory_order_relaxed);
+  const bool overloaded = isOverloaded(topology);
+  // A node's outputs are only read by nodes scheduled after it, so resetting
+  // them right before process() is equivalent to a separate reset pass
+  for (const auto& step : topology.schedule) {
+    auto node = step.node;
+    if (step.reset) {
+      node->reset();
+    }
+    // Nodes starved by their upstream are skipped, leaving their outputs
+    // empty for the nodes after them, and so are pruned nodes
+    if (node->isPruned() || !node->isReady()) {
+      continue;
+    }
+    if (overloaded && isDeferred(step, sequence)) {
+      node->counters().countDeferral();
+      continue;
+    }
+    // Inputs are counted upfront, in-place nodes take their blocks
+    node->countInputs();
+    const auto start = std::chrono::steady_clock::now();
+    {
+      AllocationScope allocations(*node, allocationPolicy);
+      node->process();
+    }
+    node->counters().recordProcess(std::chrono::steady_clock::now() - start);
+    node->countOutputs();
+  }
+}
+
+bool Graph::isOverloaded(const Subgraph& topology) {
+  if (!overloadHandling_) {
+    return false;
+  }
+  // Hysteresis keeps the graph from flapping in and out of overload
+  const double watermark = topology.backlogged ? overloadOptions_.lowWatermark
+                                               : overloadOptions_.highWatermark;
+  const bool backlogged = std::any_of(
+      topology.inQueues.begin(),
+      topology.inQueues.end(),
+      [watermark](const InputQueue& input) {
+        return static_cast<double>(input.queue->size()) >=
+            watermark * static_cast<double>(input.queue->capacity());
+      });
+  if (backlogged != topology.backlogged) {
+    topology.backlogged = backlogged;
+    if (backlogged) {
+      ++backloggedSubgraphs_;
+    } else {
+      --backloggedSubgraphs_;
+    }
+  }
+  return backloggedSubgraphs_.load(std::memory_order_relaxed) != 0;
+}
+
+bool Graph::isDeferred(const ScheduleStep& step, BlockSequence sequence)
+    const {
+  switch (step.priority) {
+    case NodePriority::RealTime:
+      return false;
+    case NodePriority::Low:
+      return !step.node->hasInputData();
+    case NodePriority::Background:
+      // Blocks without a number are not decimated
+      return sequence != UnknownBlockSequence &&
+          sequence % std::max<size_t>(overloadOptions_.decimation, 1) != 0;
+  }
+  return false;
+}
+
+void Graph::initAllNodes() {
+  // Nodes do not touch each other until they process data, so the heavy
+  // init() calls (filter design, encoder and decoder setup) run concurrently
+  // on the thread pool. Sources start last, once everything downstream of
+  // them is ready for their data.
+  std::vector<std::pair<BaseNode*, BlockPool*>> concurrent;
+  std::vector<std::pair<BaseNode*, BlockPool*>> last;
+  for (const auto& t : subgraphs_) {
+    for (const auto& step : t->schedule) {
+      auto& nodes = step.node->initLast() ? last : concurrent;
+      nodes.emplace_back(step.node, t->pool.get());
+    }
+  }
+
+  initLatch_.reset(concurrent.size());
+  for (const auto& pair : concurrent) {
+    ThreadPool::shared().submit([this, pair]() {
+      initNode(pair.first, pair.second);
+      initLatch_.arrive();
+    });
+  }
+  initLatch_.wait();
+
+  for (const auto& pair : last) {
+    initNode(pair.first, pair.second);
+  }
+  startupDuration_ = std::chrono::steady_clock::now() - startTime_;
+}
+
+void Graph::initNode(BaseNode* node, BlockPool* pool) {
+  node->setBlockPool(pool);
+  const auto start = std::chrono::steady_clock::now();
+  try {
+    node->init();
+  } catch (const std::exception& ex) {
+    std::cerr << "Graph node exception in init(): " << ex.what() << std::endl;
+  }
+  node->counters().recordInit(
+      start - startTime_, std::chrono::steady_clock::now() - start);
+}
+
+void Graph::destroyNodes(const Schedule& schedule) {
+  std::vector<BaseOutput*> ports;
+  for (const auto& step : schedule) {
+    auto node = step.node;
     try {
-      node->destroy();
+      if (!node->isPruned()) {
+        node->destroy();
+      }
     } catch (const std::exception& ex) {
       std::cerr << "Graph node exception in destroy(): " << ex.what()
                 << std::endl;
     }
+    node->setPruned(false);
+    ports.clear();
+    node->collectOutputs(ports);
+    for (auto port : ports) {
+      port->setDemanded(true);
+    }
+    node->setBlockPool(nullptr);
+    node->setShardExecutor(nullptr);
   }
 }
 
-void Graph::runActions(const Subgraph& topology) {
-  auto& actions = topology.actions;
-  std::lock_guard<std::mutex> lock(actions->mutex);
-  for (const auto& action : actions->data) {
-    action();
+bool Graph::prepareInputs(const Subgraph& topology, BlockSequence& sequence) {
+  if (topology.readiness == InputReadiness::AllAligned &&
+      !alignInputs(topology)) {
+    return false;
   }
-  actions->data.clear();
+
+  // The iteration is numbered after the oldest block from the subgraph's own
+  // source, unless some of them carry no sequence number
+  bool sequenced = true;
+  sequence = UnknownBlockSequence;
+  for (const auto& input : topology.inQueues) {
+    BlockSequence front;
+    if (input.source != topology.source || input.queue->size() == 0) {
+      continue;
+    }
+    if (!input.queue->frontSequence(front) ||
+        front == ControlTransaction::Unassigned) {
+      sequenced = false;
+      continue;
+    }
+    sequence = std::min(sequence, front);
+  }
+  if (!sequenced) {
+    sequence = UnknownBlockSequence;
+  }
+
+  // Blocks from other sources are never held, their numbers do not compare
+  for (const auto& input : topology.inQueues) {
+    BlockSequence front;
+    input.queue->setHeld(
+        input.source == topology.source &&
+        input.queue->frontSequence(front) &&
+        front != ControlTransaction::Unassigned && front > sequence);
+  }
+  return true;
 }
 
-bool Graph::waitForData(const Subgraph& topology) {
-  const auto& queue = topology.inQueue;
-  if (!queue) {
-    return true;
+bool Graph::alignInputs(const Subgraph& topology) {
+  // Subgraphs have a handful of input queues at most, comparing every pair
+  // beats allocating a map per iteration
+  for (const auto& input : topology.inQueues) {
+    if (input.queue->size() == 0) {
+      return false;
+    }
+    BlockSequence newest = ControlTransaction::Unassigned;
+    for (const auto& other : topology.inQueues) {
+      BlockSequence front;
+      if (other.source == input.source && other.queue->frontSequence(front)) {
+        newest = std::max(newest, front);
+      }
+    }
+    BlockSequence front;
+    while (input.queue->frontSequence(front) &&
+           front != ControlTransaction::Unassigned && front < newest &&
+           input.queue->discardFront()) {
+    }
+    if (input.queue->size() == 0) {
+      return false;
+    }
   }
-  using namespace std::chrono_literals;
-  return queue->waitForData(10ms);
+  return true;
 }
 
-void Graph::postUpdates(std::unordered_map<std::string, boost::any>&& updates) {
-  struct SetterWithValue {
-    const BindingSetterType& setter;
-    const boost::any& value;
+BlockPoolStats Graph::blockPoolStats() const {
+  BlockPoolStats total;
+  for (const auto& t : subgraphs_) {
+    if (!t->pool) {
+      continue;
+    }
+    const auto stats = t->pool->stats();
+    total.hits += stats.hits;
+    total.misses += stats.misses;
+  }
+  return total;
+}
+
+std::unordered_map<const BaseNode*, std::string> Graph::nodeNames() const {
+  std::unordered_set<const BaseNode*> queueNodes;
+  for (const auto& node : extraNodes_) {
+    queueNodes.insert(node.get());
+  }
+
+  // Nodes in the order they were added, so that nodes of the same type are
+  // told apart the same way in every snapshot
+  std::vector<const BaseNode*> nodes;
+  for (const auto& t : subgraphs_) {
+    for (const auto node : t->nodes) {
+      if (!queueNodes.count(node)) {
+        nodes.push_back(node);
+      }
+    }
+  }
+  std::sort(nodes.begin(), nodes.end(), [this](const auto a, const auto b) {
+    return nodeOrder_.at(a) < nodeOrder_.at(b);
+  });
+
+  std::unordered_map<const BaseNode*, std::string> names;
+  std::unordered_map<std::string, size_t> nameCounts;
+  for (const auto node : nodes) {
+    auto name = node->name();
+    if (const auto count = ++nameCounts[name]; count > 1) {
+      name += "#" + std::to_string(count);
+    }
+    names[node] = std::move(name);
+  }
+  return names;
+}
+
+GraphStats Graph::stats() const {
+  std::shared_lock<std::shared_mutex> lock(topologyMutex_);
+  std::unordered_set<const BaseNode*> queueNodes;
+  for (const auto& node : extraNodes_) {
+    queueNodes.insert(node.get());
+  }
+
+  GraphStats stats;
+  stats.uptime = std::chrono::steady_clock::now() - startTime_;
+  stats.startup = startupDuration_;
+  stats.rebalances = rebalances_.load(std::memory_order_relaxed);
+  stats.rebalanceDrops = rebalanceDrops_.load(std::memory_order_relaxed);
+
+  const auto names = nodeNames();
+  for (size_t index = 0; index < subgraphs_.size(); ++index) {
+    const auto& t = subgraphs_[index];
+    for (const auto node : t->nodes) {
+      if (queueNodes.count(node)) {
+        continue;
+      }
+      NodeStats nodeStats;
+      nodeStats.name = names.at(node);
+      nodeStats.subgraph = index;
+      node->counters().snapshot(nodeStats);
+      stats.nodes.push_back(std::move(nodeStats));
+    }
+
+    SubgraphStats subgraphStats;
+    subgraphStats.pooled = isPooled(*t);
+    subgraphStats.thread = t->threadConfig.name;
+    stats.subgraphs.push_back(std::move(subgraphStats));
+  }
+
+  std::unordered_map<const BaseNode*, size_t> queueCounts;
+  for (const auto& t : subgraphs_) {
+    for (const auto& pair : t->edges) {
+      for (const auto to : pair.second) {
+        if (queueNodes.count(pair.first) || queueNodes.count(to)) {
+          continue;
+        }
+        EdgeStats edgeStats;
+        edgeStats.from = names.at(pair.first);
+        edgeStats.to = names.at(to);
+        stats.edges.push_back(std::move(edgeStats));
+      }
+    }
+    for (const auto& input : t->inQueues) {
+      if (!input.counters) {
+        continue;
+      }
+      // Queues are named after their consumer, further queues into the same
+      // consumer are numbered
+      QueueStats queueStats;
+      queueStats.name = names.at(input.consumer);
+      if (const auto count = ++queueCounts[input.consumer]; count > 1) {
+        queueStats.name += ":" + std::to_string(count);
+      }
+      queueStats.size = input.queue->size();
+      queueStats.capacity = input.queue->capacity();
+      queueStats.highWaterMark = input.queue->highWaterMark();
+      queueStats.drops = input.queue->drops();
+      queueStats.underruns = input.queue->underruns();
+      input.counters->snapshot(queueStats);
+
+      EdgeStats edgeStats;
+      edgeStats.from = names.at(input.producer);
+      edgeStats.to = names.at(input.consumer);
+      edgeStats.queue = queueStats.name;
+      edgeStats.queued = true;
+      stats.edges.push_back(std::move(edgeStats));
+      stats.queues.push_back(std::move(queueStats));
+    }
+  }
+
+  const auto byName = [](const auto& a, const auto& b) {
+    return a.name < b.name;
   };
+  std::stable_sort(stats.nodes.begin(), stats.nodes.end(), byName);
+  std::stable_sort(stats.queues.begin(), stats.queues.end(), byName);
+  std::sort(
+      stats.edges.begin(), stats.edges.end(), [](const auto& a, const auto& b) {
+        return std::tie(a.from, a.to, a.queue) <
+            std::tie(b.from, b.to, b.queue);
+      });
+  return stats;
+}
 
-  // Map updates to threads
-  std::unordered_map<Subgraph*, std::vector<SetterWithValue>> threads;
-  for (const auto& pair : updates) {
+bool Graph::hasData(const Subgraph& topology) {
+  // Source subgraphs block in their input node instead
+  if (topology.inQueues.empty()) {
+    return true;
+  }
+  const auto hasBlocks = [](const InputQueue& input) {
+    return input.queue->size() != 0;
+  };
+  if (topology.readiness == InputReadiness::AllAligned) {
+    return std::all_of(
+        topology.inQueues.begin(), topology.inQueues.end(), hasBlocks);
+  }
+  return std::any_of(
+      topology.inQueues.begin(), topology.inQueues.end(), hasBlocks);
+}
+
+void Graph::guardAllocations(AllocationPolicy policy) {
+  if (!AllocationScope::isEnabled() && policy != AllocationPolicy::None) {
+    std::cerr << "Allocation guard not built in, see EASYSDR_ALLOCATION_GUARD"
+              << std::endl;
+  }
+  allocationPolicy_.store(policy, std::memory_order_relaxed);
+}
+
+void Graph::postUpdates(std::unordered_map<std::string, boost::any>&& updates) {
+  std::shared_lock<std::shared_mutex> lock(topologyMutex_);
+  // Map updates to subgraphs
+  std::unordered_map<Subgraph*, std::unique_ptr<ControlMessage>> messages;
+  for (auto& pair : updates) {
     const auto found = bindings_.find(pair.first);
     if (found == bindings_.end()) {
       continue;
     }
+    // Bindings of the same name share the value
+    const auto value = std::make_shared<boost::any>(std::move(pair.second));
     for (const auto& binding : found->second) {
-      auto* subgraph = findSubgraph(&binding.node);
+      // Controls of fused stages are applied by the subgraph of the
+      // enclosing node
+      const BaseNode* node = &binding.node;
+      while (node->enclosingNode()) {
+        node = node->enclosingNode();
+      }
+      auto* subgraph = findSubgraph(node);
       if (!subgraph) {
         throw std::runtime_error("invalid control node");
       }
-      threads[subgraph].push_back(SetterWithValue{
-          .setter = binding.setter,
-          .value = pair.second,
+      auto& message = messages[subgraph];
+      if (!message) {
+        message = std::make_unique<ControlMessage>();
+      }
+      message->updates.push_back(ControlUpdate{
+          .key = &binding,
+          .apply = [setter = &binding.setter, value]() { (*setter)(*value); },
       });
     }
   }
 
-  if (threads.empty()) {
+  postMessages(messages);
+}
+
+void Graph::refreshDemand() {
+  std::shared_lock<std::shared_mutex> lock(topologyMutex_);
+  if (std::any_of(subgraphs_.begin(), subgraphs_.end(), [](const auto& t) {
+        return !t->controls;
+      })) {
+    // Not running yet
     return;
   }
 
-  // TODO implement transaction support: stop all threads
-
-  const auto storage =
-      std::make_shared<std::unordered_map<std::string, boost::any>>(
-          std::move(updates));
+  // Nodes each node reads from, across queues as well
+  std::unordered_map<BaseNode*, std::vector<BaseNode*>> upstream;
+  std::unordered_set<BaseNode*> hasDownstream;
+  const auto addEdge = [&](BaseNode* from, BaseNode* to) {
+    upstream[to].push_back(from);
+    hasDownstream.insert(from);
+  };
+  for (const auto& t : subgraphs_) {
+    for (auto node : t->nodes) {
+      upstream[node];
+    }
+    for (const auto& pair : t->edges) {
+      for (auto to : pair.second) {
+        addEdge(pair.first, to);
+      }
+    }
+    for (const auto& input : t->inQueues) {
+      addEdge(input.queueOut, input.queueIn);
+    }
+  }
 
-  // Execute updates in threads
-  for (const auto& pair : threads) {
-    auto* subgraph = pair.first;
+  // Everything upstream of a sink with subscribers is demanded, and so are
+  // the sources
+  std::vector<BaseNode*> pending;
+  for (const auto& pair : upstream) {
+    auto node = pair.first;
+    if (pair.second.empty() ||
+        (!hasDownstream.count(node) && node->hasSubscribers())) {
+      pending.push_back(node);
+    }
+  }
+  std::unordered_set<BaseNode*> demanded;
+  while (!pending.empty()) {
+    auto node = pending.back();
+    pending.pop_back();
+    if (demanded.insert(node).second) {
+      const auto& from = upstream[node];
+      pending.insert(pending.end(), from.begin(), from.end());
+    }
+  }
 
-    const auto refs =
-        std::make_shared<std::vector<SetterWithValue>>(pair.second);
+  // Outputs are demanded when a demanded node reads them
+  std::unordered_set<BaseOutput*> demandedOutputs;
+  std::vector<BaseOutput*> ports;
+  for (auto node : demanded) {
+    ports.clear();
+    node->collectSources(ports);
+    demandedOutputs.insert(ports.begin(), ports.end());
+  }
 
-    auto& actions = subgraph->actions;
-    std::lock_guard<std::mutex> lock(actions->mutex);
-    actions->data.push_back([storage, refs] {
-      for (const auto& ref : *refs) {
-        try {
-          ref.setter(ref.value);
-        } catch (const std::exception& ex) {
-          std::cerr << "Exception setting control value: " << ex.what()
-                    << std::endl;
+  std::lock_guard<std::mutex> demandLock(demandMutex_);
+  std::unordered_map<Subgraph*, std::unique_ptr<ControlMessage>> messages;
+  for (const auto& t : subgraphs_) {
+    // Only changes are posted, updates of the same node or output coalescing
+    // in the mailbox are transitions between the same two states
+    std::vector<ControlUpdate> updates;
+    for (auto node : t->nodes) {
+      const bool pruned = !demanded.count(node);
+      if (pruned != static_cast<bool>(prunedNodes_.count(node))) {
+        if (pruned) {
+          prunedNodes_.insert(node);
+        } else {
+          prunedNodes_.erase(node);
         }
+        updates.push_back(ControlUpdate{
+            .key = node,
+            .apply = [node, pruned]() { setPruned(node, pruned); },
+        });
       }
-    });
+      ports.clear();
+      node->collectOutputs(ports);
+      for (auto port : ports) {
+        const bool isDemanded = demandedOutputs.count(port);
+        if (isDemanded != static_cast<bool>(undemandedOutputs_.count(port))) {
+          continue;
+        }
+        if (isDemanded) {
+          undemandedOutputs_.erase(port);
+        } else {
+          undemandedOutputs_.insert(port);
+        }
+        updates.push_back(ControlUpdate{
+            .key = port,
+            .apply = [port, isDemanded]() { port->setDemanded(isDemanded); },
+        });
+      }
+    }
+    if (!updates.empty()) {
+      auto message = std::make_unique<ControlMessage>();
+      message->updates = std::move(updates);
+      messages.emplace(t.get(), std::move(message));
+    }
+  }
+  postMessages(messages);
+}
+
+void Graph::setPruned(BaseNode* node, bool pruned) {
+  if (node->isPruned() == pruned && pruned) {
+    return;
+  }
+  // Nodes reactivated before their pruning took effect are restarted all
+  // the same, so that they always come back with a clean state
+  try {
+    if (!node->isPruned()) {
+      node->destroy();
+    }
+    if (!pruned) {
+      node->init();
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << "Graph node exception while "
+              << (pruned ? "pruning " : "reactivating ") << node->name()
+              << ": " << ex.what() << std::endl;
+  }
+  node->setPruned(pruned);
+}
+
+void Graph::postMessages(
+    std::unordered_map<Subgraph*, std::unique_ptr<ControlMessage>>& messages) {
+  if (messages.empty()) {
+    return;
+  }
+
+  // One transaction per source: the source assigns it the number of its next
+  // block, and the subgraphs downstream apply it when that block reaches them
+  std::unordered_map<Subgraph*, std::shared_ptr<ControlTransaction>>
+      transactions;
+  for (auto& pair : messages) {
+    auto* source = pair.first->source;
+    auto& transaction = transactions[source];
+    if (!transaction) {
+      transaction = std::make_shared<ControlTransaction>();
+    }
+    pair.second->transaction = transaction;
+    pair.second->anchor = pair.first == source;
+  }
+  for (const auto& pair : transactions) {
+    auto* source = pair.first;
+    if (!messages.count(source)) {
+      auto anchor = std::make_unique<ControlMessage>();
+      anchor->transaction = pair.second;
+      anchor->anchor = true;
+      messages.emplace(source, std::move(anchor));
+    }
+  }
+
+  // Anchors go last, so that the other subgraphs have their messages by the
+  // time the transaction's block reaches them
+  for (const bool anchors : {false, true}) {
+    for (auto& pair : messages) {
+      if (!pair.second || pair.second->anchor != anchors) {
+        continue;
+      }
+      auto* subgraph = pair.first;
+      subgraph->controls->post(std::move(pair.second));
+      if (subgraph->notifier) {
+        subgraph->notifier->notify();
+      }
+    }
   }
 }
 
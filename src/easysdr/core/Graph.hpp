@@ -7,17 +7,32 @@
 
 #pragma once
 
+#include "AllocationGuard.hpp"
+#include "BlockPool.hpp"
+#include "BlockSequence.hpp"
+#include "ControlMailbox.hpp"
 #include "Latch.hpp"
 #include "Node.hpp"
+#include "Notifier.hpp"
+#include "Partition.hpp"
+#include "Priority.hpp"
 #include "Queue.hpp"
 #include "QueueIn.hpp"
 #include "QueueOut.hpp"
+#include "SPSCQueue.hpp"
+#include "Shard.hpp"
+#include "Stats.hpp"
+#include "ThreadConfig.hpp"
+#include "ThreadPool.hpp"
 
 #include <boost/any.hpp>
 #include <atomic>
 #include <condition_variable>
+#include <list>
 #include <mutex>
+#include <shared_mutex>
 #include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -26,14 +41,46 @@ namespace SDR {
 
 class Graph final {
  public:
+  enum class ExecutionMode {
+    // Every subgraph runs on a thread of its own
+    ThreadPerSubgraph,
+    // Subgraphs fed by a queue run one iteration at a time on the shared
+    // thread pool whenever data or control updates arrive, source subgraphs
+    // keep a thread of their own
+    ThreadPool,
+  };
+
+  // When a subgraph fed by several queues runs an iteration
+  enum class InputReadiness {
+    // As soon as any queue has data. Queues fed from the same source hand
+    // over their blocks in sequence order, the oldest first, and blocks due
+    // later are held for the following iterations. Nodes whose inputs get no
+    // block in an iteration are skipped, see OptionalInput.
+    Any,
+    // Once every queue has data. Blocks older than the newest block at the
+    // front of another queue fed from the same source are discarded, so the
+    // blocks processed together were derived from the same input samples.
+    AllAligned,
+  };
+
   Graph() {}
 
+  // Must be called before startRunning()
+  void setExecutionMode(ExecutionMode mode);
+  ExecutionMode executionMode() const;
+
   template <class FromNode, class ToNode>
   Graph& connect(FromNode& fromNode, ToNode& toNode);
 
   template <class FromNode, class ToNode>
   Graph& connectQueued(FromNode& fromNode, ToNode& toNode);
 
+  template <class FromNode, class ToNode>
+  Graph& connectQueued(
+      FromNode& fromNode,
+      ToNode& toNode,
+      const QueueOptions& options);
+
   template <size_t FromIdx, size_t ToIdx, class FromNode, class ToNode>
   Graph& connect(FromNode& fromNode, ToNode& toNode);
 
@@ -41,6 +88,12 @@ class Graph final {
   Graph&
   connectQueued(FromNode& fromNode, ToNode& toNode, size_t queueSize = 100);
 
+  template <size_t FromIdx, size_t ToIdx, class FromNode, class ToNode>
+  Graph& connectQueued(
+      FromNode& fromNode,
+      ToNode& toNode,
+      const QueueOptions& options);
+
   template <typename DataType>
   using BindingValidator = std::function<DataType(const DataType&)>;
 
@@ -54,22 +107,149 @@ class Graph final {
       BindingValidator<DataType> validator = nullptr);
   Graph& unbindAll();
 
+  // Applies |config| to the thread of the subgraph |node| ends up in. Only
+  // subgraphs with a thread of their own can be configured, subgraphs run on
+  // the thread pool share its config, see ThreadPool::setSharedThreadConfig().
+  // Must be called before startRunning().
+  Graph& setThreadConfig(const BaseNode& node, const ThreadConfig& config);
+
+  // Sets the rule of the subgraph |node| ends up in, Any by default. Only
+  // makes a difference to subgraphs fed by several queues. Must be called
+  // before startRunning().
+  Graph& setInputReadiness(const BaseNode& node, InputReadiness readiness);
+
+  // Declares the share of a CPU core |node| is expected to keep busy, see
+  // partition()
+  Graph& setNodeCost(const BaseNode& node, double cost);
+
+  // Sets how |node| fares under overload, RealTime by default, see
+  // setOverloadHandling()
+  Graph& setNodePriority(const BaseNode& node, NodePriority priority);
+
+  // Splits every subgraph fed by a queue into pipeline stages of balanced
+  // cost by moving edges made with connect() onto queues, see
+  // PartitionOptions. Stages only start where all edges into them come from
+  // the same output, so that the blocks of an iteration reach the stage
+  // together, and stages fed by several queues wait for all of them, see
+  // InputReadiness::AllAligned. Only the first call before startRunning()
+  // has any effect.
+  void partition(const PartitionOptions& options = PartitionOptions{});
+
+  // Keeps measuring the cost of the nodes of the subgraphs split by
+  // partition() while the graph is running, and moves nodes to a
+  // neighboring stage when that relieves the most expensive one. Nodes move
+  // in between blocks: the stages pause, the blocks between them are
+  // processed, and the blocks arriving meanwhile wait in the queue in front
+  // of the first stage. The move is given up before that queue fills up,
+  // see RebalanceOptions::maxBacklog, and blocks it drops anyway are
+  // counted in GraphStats::rebalanceDrops. Thread pool execution mode only.
+  // Must be called before startRunning().
+  void setRebalancing(const RebalanceOptions& options);
+
+  // Lets nodes declaring themselves shardable split large blocks across the
+  // workers of the shared thread pool, see BaseNode::isShardable(). Works in
+  // either execution mode. Must be called before startRunning().
+  void setSharding(const ShardOptions& options);
+
+  // Watches the input queues of all subgraphs, and while any of them backs
+  // up, which means the CPU cannot keep up, defers the nodes of lower
+  // priority in every subgraph, see NodePriority and NodeStats::deferrals.
+  // Must be called before startRunning().
+  void setOverloadHandling(const OverloadOptions& options);
+
+  // Ends warm-up: from now on heap allocations made by process() of any
+  // node are handled according to |policy|, see NodeStats::allocations.
+  // Only has an effect in builds with EASYSDR_ALLOCATION_GUARD. May be called
+  // from any thread while the graph is running.
+  void guardAllocations(AllocationPolicy policy);
+
+  // Updates posted together take effect in all subgraphs starting from the
+  // same block, may be called from any thread while the graph is running
   void postUpdates(std::unordered_map<std::string, boost::any>&& updates);
 
+  // Prunes the nodes which only feed sinks without subscribers, see
+  // BaseNode::hasSubscribers(). Pruned nodes are destroyed and skipped until
+  // a sink downstream of them gets subscribers again, then they are
+  // initialized anew, starting from a clean filter state. Sources are never
+  // pruned, they pace their subgraphs. Changes take effect like control
+  // updates, starting from the same block in all subgraphs, so subgraphs
+  // no longer getting any blocks merely idle. Called by startRunning(), and
+  // by whoever changes what a sink reports, from any thread while the graph
+  // is running.
+  void refreshDemand();
+
   void startRunning();
   void stopRunning();
 
+  // Aggregated block pool counters of all subgraphs
+  BlockPoolStats blockPoolStats() const;
+
+  // Per-node process() costs and input queue occupancy since startRunning(),
+  // may be called from any thread while the graph is running
+  GraphStats stats() const;
+
  private:
-  struct ControlActions {
-    std::mutex mutex;
-    std::vector<std::function<void()>> data;
+  struct PoolTask;
+
+  // Step of the flattened execution schedule of a subgraph
+  struct ScheduleStep {
+    BaseNode* node;
+    // Nodes without outputs have nothing to reset
+    bool reset;
+    NodePriority priority;
+  };
+
+  using Schedule = std::vector<ScheduleStep>;
+
+  struct Subgraph;
+
+  // Queue feeding a subgraph from a node in another subgraph
+  struct InputQueue {
+    std::unique_ptr<BaseQueue> queue;
+    BaseNode* producer = nullptr;
+    BaseNode* consumer = nullptr;
+    // Queue nodes at either end
+    BaseNode* queueIn = nullptr;
+    BaseNode* queueOut = nullptr;
+    std::unique_ptr<QueueCounters> counters;
+    // Source subgraph numbering the blocks in the queue, sequence numbers
+    // only compare between queues with the same source
+    Subgraph* source = nullptr;
   };
 
   struct Subgraph {
-    std::unique_ptr<BaseQueue> inQueue;
+    // In the order the queues were connected
+    std::vector<InputQueue> inQueues;
+    InputReadiness readiness = InputReadiness::Any;
     std::unordered_set<BaseNode*> nodes;
     std::unordered_map<BaseNode*, std::unordered_set<BaseNode*>> edges;
-    std::unique_ptr<ControlActions> actions;
+    std::unique_ptr<ControlMailbox> controls;
+    std::unique_ptr<Notifier> notifier;
+    std::unique_ptr<BlockPool> pool;
+    std::unique_ptr<PoolTask> poolTask;
+    Schedule schedule;
+    ThreadConfig threadConfig;
+    // Source subgraph numbering the blocks this subgraph processes, anchors
+    // the control transactions involving it. Subgraphs fed from several
+    // sources follow the source of their first queue.
+    Subgraph* source = nullptr;
+    // Whether the input queues are backed up, see OverloadOptions. Only
+    // touched by the thread running the subgraph.
+    mutable bool backlogged = false;
+  };
+
+  // Runs a subgraph on the thread pool. At most one iteration of a subgraph
+  // is scheduled at any time, which keeps its blocks in order.
+  struct PoolTask final {
+    PoolTask(Subgraph& topology) : topology(topology) {}
+
+    Subgraph& topology;
+    std::atomic<bool> scheduled{false};
+    // Iterations submitted to the pool which have not returned yet
+    std::atomic<size_t> active{0};
+    // Signaled whenever an iteration returns, see pauseIteration()
+    std::mutex mutex;
+    std::condition_variable returned;
   };
 
   using BindingSetterType = std::function<void(const boost::any&)>;
@@ -79,8 +259,52 @@ class Graph final {
     BindingSetterType setter;
   };
 
+  // Edge made with connect(), which partition() may move onto a queue and
+  // back
+  struct Link {
+    BaseNode* from;
+    BaseNode* to;
+    // Output the edge starts from
+    const void* port;
+    std::function<void(Link&, const QueueOptions&)> queue;
+    std::function<void(Link&)> unqueue;
+    // Set while the edge runs through a queue
+    BaseNode* queueIn = nullptr;
+    BaseNode* queueOut = nullptr;
+    const BaseQueue* inQueue = nullptr;
+  };
+
+  // Subgraph split into stages by partition()
+  struct Pipeline {
+    // Nodes in schedule order, queue nodes follow the node they connect to
+    std::vector<BaseNode*> nodes;
+    // Whether a stage may start at a node
+    std::vector<bool> cuts;
+    // Stage of every node
+    std::vector<size_t> stages;
+    std::vector<Subgraph*> subgraphs;
+    std::vector<Link*> links;
+    QueueOptions queueOptions;
+    // Measured by the rebalancer
+    std::vector<uint64_t> processNanos;
+    std::chrono::steady_clock::time_point measuredAt;
+  };
+
+  // Queue nodes inserted by connectQueued() are never queued again
+  template <class T>
+  struct IsQueueNode : std::false_type {};
+
+  template <typename DataType, class QueueT>
+  struct IsQueueNode<QueueIn<DataType, QueueT>> : std::true_type {};
+
+  template <typename DataType, class QueueT>
+  struct IsQueueNode<QueueOut<DataType, QueueT>> : std::true_type {};
+
  private:
   void runner(const Subgraph& sub);
+  bool isPooled(const Subgraph& topology) const;
+  void scheduleIteration(PoolTask& task);
+  void runIteration(PoolTask& task);
   Subgraph* createSubgraph();
   Subgraph* findSubgraph(const BaseNode* node);
   void addNodeToSubgraph(BaseNode* node, Subgraph* sub);
@@ -88,20 +312,87 @@ class Graph final {
   void ensureDisconnectedSubgraphs(BaseNode* node0, BaseNode* node1);
   void mergeSubgraphs(Subgraph* sub0, Subgraph* sub1);
   std::vector<BaseNode*> topologicalSort(const Subgraph& topology);
-  void initNodes(const std::vector<BaseNode*>& nodes);
-  void destroyNodes(const std::vector<BaseNode*>& nodes);
-  void runActions(const Subgraph& topology);
-  bool waitForData(const Subgraph& topology);
+  Schedule compileSchedule(const Subgraph& topology);
+  void initAllNodes();
+  void initNode(BaseNode* node, BlockPool* pool);
+  void destroyNodes(const Schedule& schedule);
+  Subgraph* findSource(Subgraph* topology);
+  void processNodes(const Subgraph& topology, BlockSequence sequence);
+  bool isOverloaded(const Subgraph& topology);
+  bool isDeferred(const ScheduleStep& step, BlockSequence sequence) const;
+  bool prepareInputs(const Subgraph& topology, BlockSequence& sequence);
+  bool alignInputs(const Subgraph& topology);
+  bool hasData(const Subgraph& topology);
+  void partitionSubgraph(
+      Subgraph* sub,
+      const std::function<double(const BaseNode*)>& cost,
+      size_t maxStages,
+      const PartitionOptions& options);
+  void reshapePipeline(Pipeline& pipeline, const std::vector<size_t>& stages);
+  void removeQueueNodes(Link& link);
+  void rebalancer();
+  void rebalance(Pipeline& pipeline);
+  bool migrate(Pipeline& pipeline, const std::vector<size_t>& stages);
+  void pauseIteration(PoolTask& task);
+  void attachInputQueues(Subgraph& topology);
+  void postMessages(
+      std::unordered_map<Subgraph*, std::unique_ptr<ControlMessage>>& messages);
+  // Applied by the subgraph running |node|
+  static void setPruned(BaseNode* node, bool pruned);
+  // Names of the nodes in stats, numbered when several share a name
+  std::unordered_map<const BaseNode*, std::string> nodeNames() const;
 
  private:
+  ExecutionMode executionMode_ = ExecutionMode::ThreadPerSubgraph;
+  std::chrono::steady_clock::time_point startTime_;
+  std::chrono::steady_clock::duration startupDuration_{};
   std::vector<std::thread> threads_;
   std::atomic<bool> stopping_;
   Latch initLatch_;
   Latch destroyLatch_;
-  std::unordered_set<std::shared_ptr<Subgraph>> subgraphs_;
+  std::vector<std::shared_ptr<Subgraph>> subgraphs_;
   std::unordered_map<const BaseNode*, Subgraph*> nodeToSubgraph_;
+  // Order in which nodes were added to the graph, breaks ties between nodes
+  // in the schedule so that it is the same from run to run
+  std::unordered_map<const BaseNode*, size_t> nodeOrder_;
   std::vector<std::unique_ptr<BaseNode>> extraNodes_;
   std::unordered_map<std::string, std::vector<Binding>> bindings_;
+  // Subgraphs are only final once the graph is assembled, configs are
+  // resolved to them by startRunning()
+  std::unordered_map<const BaseNode*, ThreadConfig> threadConfigs_;
+  std::unordered_map<const BaseNode*, InputReadiness> inputReadiness_;
+  // Node addresses stay valid as links come and go
+  std::list<Link> links_;
+  std::unordered_map<const BaseNode*, double> nodeCosts_;
+  std::unordered_map<const BaseNode*, NodePriority> nodePriorities_;
+  bool partitioned_ = false;
+  std::vector<Pipeline> pipelines_;
+  size_t nextNodeOrder_ = 0;
+  // Guards the subgraphs against the rebalancer for the callers of stats()
+  // and postUpdates(), the subgraphs themselves are paused while it moves
+  // nodes
+  mutable std::shared_mutex topologyMutex_;
+  RebalanceOptions rebalanceOptions_;
+  bool rebalancing_ = false;
+  std::thread rebalancer_;
+  std::mutex rebalancerMutex_;
+  std::condition_variable rebalancerCondition_;
+  std::atomic<uint64_t> rebalances_{0};
+  std::atomic<uint64_t> rebalanceDrops_{0};
+  ShardOptions shardOptions_;
+  bool sharding_ = false;
+  std::unique_ptr<ShardExecutor> shardExecutor_;
+  std::atomic<AllocationPolicy> allocationPolicy_{AllocationPolicy::None};
+  OverloadOptions overloadOptions_;
+  bool overloadHandling_ = false;
+  // Number of subgraphs whose input queues are backed up, the graph is
+  // overloaded while there are any
+  std::atomic<size_t> backloggedSubgraphs_{0};
+  // Nodes pruned and outputs no longer read as of the last refreshDemand(),
+  // their subgraphs may not have caught up yet
+  std::unordered_set<BaseNode*> prunedNodes_;
+  std::unordered_set<BaseOutput*> undemandedOutputs_;
+  std::mutex demandMutex_;
 };
 
 template <class FromNode, class ToNode>
@@ -118,6 +409,16 @@ Graph& Graph::connectQueued(FromNode& fromNode, ToNode& toNode) {
   return *this;
 }
 
+template <class FromNode, class ToNode>
+Graph& Graph::connectQueued(
+    FromNode& fromNode,
+    ToNode& toNode,
+    const QueueOptions& options) {
+  connectQueued<FromNode::OUT_OUTPUT, ToNode::IN_INPUT, FromNode, ToNode>(
+      fromNode, toNode, options);
+  return *this;
+}
+
 template <size_t FromIdx, size_t ToIdx, class FromNode, class ToNode>
 Graph& Graph::connect(FromNode& fromNode, ToNode& toNode) {
   if (reinterpret_cast<void*>(&fromNode) == reinterpret_cast<void*>(&toNode)) {
@@ -133,7 +434,39 @@ Graph& Graph::connect(FromNode& fromNode, ToNode& toNode) {
   if (port.dataPtr()) {
     throw std::runtime_error("already connected");
   }
-  port.setDataPtr(fromNode.template portAt<FromIdx>().getDataPtr());
+  port.connect(fromNode.template portAt<FromIdx>());
+
+  if constexpr (
+      !IsQueueNode<FromNode>::value && !IsQueueNode<ToNode>::value) {
+    links_.push_back(Link{
+        .from = &fromNode,
+        .to = &toNode,
+        .port = &fromNode.template portAt<FromIdx>(),
+        .queue =
+            [this, &fromNode, &toNode](
+                Link& link, const QueueOptions& options) {
+              toNode.template portAt<ToIdx>().disconnect();
+              connectQueued<FromIdx, ToIdx>(fromNode, toNode, options);
+              // Queue nodes and the queue are the last ones added
+              link.queueIn = extraNodes_[extraNodes_.size() - 2].get();
+              link.queueOut = extraNodes_.back().get();
+              link.inQueue =
+                  findSubgraph(&toNode)->inQueues.back().queue.get();
+            },
+        .unqueue =
+            [this, &fromNode, &toNode](Link& link) {
+              using DataType = typename FromNode::template DataType<FromIdx>;
+              using QueueOutNode = QueueOut<DataType, SPSCQueue<DataType>>;
+              toNode.template portAt<ToIdx>().disconnect();
+              static_cast<QueueOutNode*>(link.queueOut)
+                  ->template portAt<QueueOutNode::IN_INPUT>()
+                  .disconnect();
+              removeQueueNodes(link);
+              toNode.template portAt<ToIdx>().connect(
+                  fromNode.template portAt<FromIdx>());
+            },
+    });
+  }
   return *this;
 }
 
@@ -142,6 +475,15 @@ Graph& Graph::connectQueued(
     FromNode& fromNode,
     ToNode& toNode,
     size_t queueSize /*= 100*/) {
+  return connectQueued<FromIdx, ToIdx, FromNode, ToNode>(
+      fromNode, toNode, QueueOptions{.size = queueSize});
+}
+
+template <size_t FromIdx, size_t ToIdx, class FromNode, class ToNode>
+Graph& Graph::connectQueued(
+    FromNode& fromNode,
+    ToNode& toNode,
+    const QueueOptions& options) {
   if (reinterpret_cast<void*>(&fromNode) == reinterpret_cast<void*>(&toNode)) {
     throw std::runtime_error("bad topology");
   }
@@ -149,22 +491,27 @@ Graph& Graph::connectQueued(
   ensureDisconnectedSubgraphs(&fromNode, &toNode);
 
   Subgraph* sub = findSubgraph(&toNode);
-  if (sub->inQueue) {
-    throw std::runtime_error("bad topology");
-  }
 
   using DataType = typename FromNode::template DataType<FromIdx>;
-  using QueueInNode = QueueIn<DataType>;
-  using QueueOutNode = QueueOut<DataType>;
+  using QueueType = SPSCQueue<DataType>;
+  using QueueInNode = QueueIn<DataType, QueueType>;
+  using QueueOutNode = QueueOut<DataType, QueueType>;
 
-  auto queue = std::make_unique<Queue<DataType>>(queueSize);
+  // Each queued edge has exactly one producer and one consumer subgraph
+  auto queue = std::make_unique<QueueType>(options);
   auto queueIn = std::make_unique<QueueInNode>(*queue);
   auto queueOut = std::make_unique<QueueOutNode>(*queue);
 
   connect<FromIdx, QueueOutNode::IN_INPUT>(fromNode, *queueOut);
   connect<QueueInNode::OUT_OUTPUT, ToIdx>(*queueIn, toNode);
 
-  sub->inQueue = std::move(queue);
+  InputQueue input;
+  input.queue = std::move(queue);
+  input.producer = &fromNode;
+  input.consumer = &toNode;
+  input.queueIn = queueIn.get();
+  input.queueOut = queueOut.get();
+  sub->inQueues.push_back(std::move(input));
   extraNodes_.push_back(std::move(queueIn));
   extraNodes_.push_back(std::move(queueOut));
   return *this;
@@ -185,6 +532,60 @@ Graph& Graph::bind(
   return *this;
 }
 
+inline void Graph::setExecutionMode(ExecutionMode mode) {
+  executionMode_ = mode;
+}
+
+inline Graph::ExecutionMode Graph::executionMode() const {
+  return executionMode_;
+}
+
+inline bool Graph::isPooled(const Subgraph& topology) const {
+  return executionMode_ == ExecutionMode::ThreadPool &&
+      !topology.inQueues.empty();
+}
+
+inline Graph& Graph::setThreadConfig(
+    const BaseNode& node,
+    const ThreadConfig& config) {
+  threadConfigs_[&node] = config;
+  return *this;
+}
+
+inline Graph& Graph::setInputReadiness(
+    const BaseNode& node,
+    InputReadiness readiness) {
+  inputReadiness_[&node] = readiness;
+  return *this;
+}
+
+inline void Graph::setRebalancing(const RebalanceOptions& options) {
+  rebalanceOptions_ = options;
+  rebalancing_ = true;
+}
+
+inline void Graph::setSharding(const ShardOptions& options) {
+  shardOptions_ = options;
+  sharding_ = true;
+}
+
+inline Graph& Graph::setNodeCost(const BaseNode& node, double cost) {
+  nodeCosts_[&node] = cost;
+  return *this;
+}
+
+inline Graph& Graph::setNodePriority(
+    const BaseNode& node,
+    NodePriority priority) {
+  nodePriorities_[&node] = priority;
+  return *this;
+}
+
+inline void Graph::setOverloadHandling(const OverloadOptions& options) {
+  overloadOptions_ = options;
+  overloadHandling_ = true;
+}
+
 inline Graph& Graph::unbindAll() {
   bindings_.clear();
   return *this;
@@ -196,7 +597,8 @@ inline Graph::Subgraph* Graph::findSubgraph(const BaseNode* node) {
 }
 
 inline Graph::Subgraph* Graph::createSubgraph() {
-  return subgraphs_.insert(std::make_shared<Subgraph>()).first->get();
+  subgraphs_.push_back(std::make_shared<Subgraph>());
+  return subgraphs_.back().get();
 }
 
 } // namespace SDR
@@ -0,0 +1,265 @@
+//
+//  GraphDump.cpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#include "GraphDump.hpp"
+
+#include "Json.hpp"
+
+#include <cstdio>
+#include <unordered_map>
+
+namespace SDR {
+
+namespace {
+
+struct NodeRates {
+  double cpuPercent = 0.;
+  double processMicros = 0.;
+  double samplesInPerSecond = 0.;
+  double samplesOutPerSecond = 0.;
+};
+
+std::unordered_map<std::string, NodeRates> computeRates(
+    const GraphStats& stats,
+    const GraphStats* previous) {
+  using namespace std::chrono;
+
+  std::unordered_map<std::string, const NodeStats*> previousNodes;
+  auto elapsed = stats.uptime;
+  if (previous) {
+    for (const auto& node : previous->nodes) {
+      previousNodes[node.name] = &node;
+    }
+    elapsed -= previous->uptime;
+  }
+  const double elapsedSeconds =
+      duration_cast<duration<double>>(elapsed).count();
+  const auto perSecond = [elapsedSeconds](uint64_t delta) {
+    return elapsedSeconds > 0. ? static_cast<double>(delta) / elapsedSeconds
+                               : 0.;
+  };
+
+  std::unordered_map<std::string, NodeRates> rates;
+  for (const auto& node : stats.nodes) {
+    const auto found = previousNodes.find(node.name);
+    const NodeStats last =
+        found != previousNodes.end() ? *found->second : NodeStats{};
+    const auto calls = node.calls - last.calls;
+    const auto processNanos = node.processNanos - last.processNanos;
+
+    auto& nodeRates = rates[node.name];
+    nodeRates.cpuPercent = perSecond(processNanos) / 1e7;
+    nodeRates.processMicros = calls
+        ? static_cast<double>(processNanos) / static_cast<double>(calls) / 1e3
+        : 0.;
+    nodeRates.samplesInPerSecond = perSecond(node.samplesIn - last.samplesIn);
+    nodeRates.samplesOutPerSecond =
+        perSecond(node.samplesOut - last.samplesOut);
+  }
+  return rates;
+}
+
+std::unordered_map<std::string, const QueueStats*> queuesByName(
+    const GraphStats& stats) {
+  std::unordered_map<std::string, const QueueStats*> queues;
+  for (const auto& queue : stats.queues) {
+    queues[queue.name] = &queue;
+  }
+  return queues;
+}
+
+std::string threadName(const SubgraphStats& subgraph) {
+  if (subgraph.pooled) {
+    return "thread pool";
+  }
+  return subgraph.thread.empty() ? "own thread" : subgraph.thread;
+}
+
+std::string format(const char* format, double value) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), format, value);
+  return buffer;
+}
+
+// 2.00M, 44.1k, 12.0
+std::string formatRate(double rate) {
+  if (rate >= 1e6) {
+    return format("%.2fM", rate / 1e6);
+  }
+  if (rate >= 1e3) {
+    return format("%.1fk", rate / 1e3);
+  }
+  return format("%.1f", rate);
+}
+
+void appendField(std::string& out, const char* name, double value) {
+  out += '"';
+  out += name;
+  out += "\":";
+  out += format("%.6g", value);
+}
+
+void appendField(std::string& out, const char* name, uint64_t value) {
+  out += '"';
+  out += name;
+  out += "\":";
+  out += std::to_string(value);
+}
+
+} // namespace
+
+std::string graphToDot(
+    const GraphStats& stats,
+    const GraphStats* previous /*= nullptr*/) {
+  const auto rates = computeRates(stats, previous);
+  const auto queues = queuesByName(stats);
+
+  std::string out = "digraph G {\n  rankdir=LR;\n  node [shape=box];\n";
+  for (size_t index = 0; index < stats.subgraphs.size(); ++index) {
+    out += "  subgraph cluster_" + std::to_string(index) + " {\n    label=";
+    appendJsonString(
+        out,
+        "subgraph " + std::to_string(index) + ": " +
+            threadName(stats.subgraphs[index]));
+    out += ";\n";
+    for (const auto& node : stats.nodes) {
+      if (node.subgraph != index) {
+        continue;
+      }
+      const auto& nodeRates = rates.at(node.name);
+      out += "    ";
+      appendJsonString(out, node.name);
+      out += " [label=";
+      appendJsonString(
+          out,
+          node.name + "\n" + format("%.1f%% CPU", nodeRates.cpuPercent) +
+              format(", %.1f us", nodeRates.processMicros));
+      out += "];\n";
+    }
+    out += "  }\n";
+  }
+
+  for (const auto& edge : stats.edges) {
+    const auto found = rates.find(edge.from);
+    std::string label = formatRate(
+                            found != rates.end()
+                                ? found->second.samplesOutPerSecond
+                                : 0.) +
+        " samples/s";
+    if (edge.queued) {
+      if (const auto queue = queues.find(edge.queue); queue != queues.end()) {
+        label += "\nqueue " + std::to_string(queue->second->size) + "/" +
+            std::to_string(queue->second->capacity) + ", " +
+            std::to_string(queue->second->drops) + " drops";
+      }
+    }
+    out += "  ";
+    appendJsonString(out, edge.from);
+    out += " -> ";
+    appendJsonString(out, edge.to);
+    out += " [label=";
+    appendJsonString(out, label);
+    out += edge.queued ? ", style=dashed];\n" : "];\n";
+  }
+  out += "}\n";
+  return out;
+}
+
+std::string graphToJson(
+    const GraphStats& stats,
+    const GraphStats* previous /*= nullptr*/) {
+  using namespace std::chrono;
+
+  const auto rates = computeRates(stats, previous);
+  const auto queues = queuesByName(stats);
+
+  std::string out = "{";
+  appendField(
+      out,
+      "uptime_ms",
+      duration_cast<duration<double, std::milli>>(stats.uptime).count());
+  out += ',';
+  appendField(out, "rebalances", stats.rebalances);
+  out += ',';
+  appendField(out, "rebalance_drops", stats.rebalanceDrops);
+
+  out += ",\"subgraphs\":[";
+  for (size_t index = 0; index < stats.subgraphs.size(); ++index) {
+    const auto& subgraph = stats.subgraphs[index];
+    out += index ? ",{" : "{";
+    appendField(out, "index", static_cast<uint64_t>(index));
+    out += ",\"thread\":";
+    appendJsonString(out, threadName(subgraph));
+    out += subgraph.pooled ? ",\"pooled\":true}" : ",\"pooled\":false}";
+  }
+
+  out += "],\"nodes\":[";
+  for (size_t index = 0; index < stats.nodes.size(); ++index) {
+    const auto& node = stats.nodes[index];
+    const auto& nodeRates = rates.at(node.name);
+    out += index ? ",{\"name\":" : "{\"name\":";
+    appendJsonString(out, node.name);
+    out += ',';
+    appendField(out, "subgraph", static_cast<uint64_t>(node.subgraph));
+    out += ',';
+    appendField(out, "calls", node.calls);
+    out += ',';
+    appendField(out, "allocations", node.allocations);
+    out += ',';
+    appendField(out, "deferrals", node.deferrals);
+    out += ',';
+    appendField(out, "cpu_percent", nodeRates.cpuPercent);
+    out += ',';
+    appendField(out, "process_us", nodeRates.processMicros);
+    out += ',';
+    appendField(out, "samples_in_per_sec", nodeRates.samplesInPerSecond);
+    out += ',';
+    appendField(out, "samples_out_per_sec", nodeRates.samplesOutPerSecond);
+    out += '}';
+  }
+
+  out += "],\"edges\":[";
+  for (size_t index = 0; index < stats.edges.size(); ++index) {
+    const auto& edge = stats.edges[index];
+    const auto found = rates.find(edge.from);
+    out += index ? ",{\"from\":" : "{\"from\":";
+    appendJsonString(out, edge.from);
+    out += ",\"to\":";
+    appendJsonString(out, edge.to);
+    out += ',';
+    appendField(
+        out,
+        "samples_per_sec",
+        found != rates.end() ? found->second.samplesOutPerSecond : 0.);
+    const auto queue = edge.queued ? queues.find(edge.queue) : queues.end();
+    if (queue != queues.end()) {
+      const auto& queueStats = *queue->second;
+      out += ",\"queue\":{";
+      appendField(out, "size", static_cast<uint64_t>(queueStats.size));
+      out += ',';
+      appendField(
+          out, "capacity", static_cast<uint64_t>(queueStats.capacity));
+      out += ',';
+      appendField(out, "average_size", queueStats.averageSize);
+      out += ',';
+      appendField(
+          out,
+          "high_water_mark",
+          static_cast<uint64_t>(queueStats.highWaterMark));
+      out += ',';
+      appendField(out, "drops", queueStats.drops);
+      out += ',';
+      appendField(out, "underruns", queueStats.underruns);
+      out += '}';
+    }
+    out += '}';
+  }
+  out += "]}\n";
+  return out;
+}
+
+} // namespace SDR
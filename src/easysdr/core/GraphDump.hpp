@@ -0,0 +1,30 @@
+//
+//  GraphDump.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include "Stats.hpp"
+
+#include <string>
+
+namespace SDR {
+
+// Topology of a running graph, from Graph::stats(), as a Graphviz DOT or a
+// JSON document. Nodes are annotated with their CPU share, edges with the
+// sample rate of their source node and the fill level of their queue, and
+// subgraphs with the thread they run on. Rates are averaged since
+// |previous|, an earlier snapshot of the same graph, or since the graph
+// started running.
+std::string graphToDot(
+    const GraphStats& stats,
+    const GraphStats* previous = nullptr);
+
+std::string graphToJson(
+    const GraphStats& stats,
+    const GraphStats* previous = nullptr);
+
+} // namespace SDR
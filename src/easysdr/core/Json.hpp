@@ -0,0 +1,17 @@
+//
+//  Json.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include <string>
+
+namespace SDR {
+
+// Appends |value| to |out| as a quoted and escaped JSON string
+void appendJsonString(std::string& out, const std::string& value);
+
+} // namespace SDR
@@ -9,12 +9,16 @@
 
 namespace SDR {
 
-void Latch::arrive_and_wait() {
-  {
-    std::lock_guard<std::mutex> lock(count_mutex_);
-    --count_;
-  }
+void Latch::arrive() {
+  // Notify under the lock: the waiter may destroy or reset the latch as soon
+  // as it sees the count drop to zero
+  std::lock_guard<std::mutex> lock(count_mutex_);
+  --count_;
   count_condition_.notify_one();
+}
+
+void Latch::arrive_and_wait() {
+  arrive();
   {
     std::unique_lock<std::mutex> lock(done_mutex_);
     done_condition_.wait(lock, [this] { return done_; });
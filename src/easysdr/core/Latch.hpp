@@ -15,6 +15,7 @@ class Latch final {
   Latch() {}
 
   void reset(size_t count);
+  void arrive();
   void arrive_and_wait();
   void wait();
 
@@ -7,36 +7,266 @@
 
 #include "Metadata.hpp"
 
-#include <boost/property_tree/json_parser.hpp>
+#include "Json.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
 
 namespace SDR {
 
 namespace {
 
-struct make_ptree_visitor : public boost::static_visitor<> {
-  make_ptree_visitor(boost::property_tree::ptree& pt, const std::string& p)
-      : ptree(pt), path(p) {}
-  boost::property_tree::ptree& ptree;
-  const std::string& path;
+// Names of the keys in MetadataKeys, in the order of their ids
+const char* const kWellKnownKeyNames[] = {
+    "sdrplay.gain",
+    "sdrplay.rf_gr",
+    "sdrplay.if_gr",
+    "sdrplay.freq",
+    "sdrplay.lna_state",
+    "sdrplay.num_lna_states",
+    "nrsc5.ber",
+    "nrsc5.ber_avg",
+    "nrsc5.ber_min",
+    "nrsc5.ber_max",
+    "nrsc5.mer_lower",
+    "nrsc5.mer_upper",
+    "id3.title",
+    "id3.artist",
+    "id3.album",
+    "id3.genre",
+    "id3.ufid_owner",
+    "id3.ufid_id",
+};
+
+static_assert(
+    sizeof(kWellKnownKeyNames) / sizeof(kWellKnownKeyNames[0]) ==
+        MetadataKeys::Count,
+    "names of the well-known metadata keys are out of sync");
+
+class KeyRegistry final {
+ public:
+  constexpr static size_t MaxKeys = 4096;
+
+  KeyRegistry() {
+    for (const char* name : kWellKnownKeyNames) {
+      add(name);
+    }
+  }
+
+  static KeyRegistry& instance() {
+    static KeyRegistry registry;
+    return registry;
+  }
+
+  MetadataKey intern(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = ids_.find(name);
+    if (found != ids_.end()) {
+      return MetadataKey(found->second);
+    }
+    return add(name);
+  }
+
+  const std::string& name(MetadataKey key) const {
+    const auto* name =
+        key.id() < MaxKeys ? names_[key.id()].load(std::memory_order_acquire)
+                           : nullptr;
+    if (!name) {
+      throw std::runtime_error("unknown metadata key");
+    }
+    return *name;
+  }
+
+ private:
+  MetadataKey add(const std::string& name) {
+    if (storage_.size() >= MaxKeys) {
+      throw std::runtime_error("too many metadata keys");
+    }
+    const auto id = static_cast<MetadataKey::Id>(storage_.size());
+    // Deque elements never move, so names can be read without the lock
+    storage_.push_back(name);
+    ids_.emplace(name, id);
+    names_[id].store(&storage_.back(), std::memory_order_release);
+    return MetadataKey(id);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<std::string, MetadataKey::Id> ids_;
+  std::deque<std::string> storage_;
+  std::array<std::atomic<const std::string*>, MaxKeys> names_{};
+};
 
-  template <typename T>
-  void operator()(T v) const {
-    ptree.put<T>(path, v);
+bool compareEntryKeys(
+    const MetadataPacket::Entry& entry0,
+    const MetadataPacket::Entry& entry1) {
+  return entry0.first < entry1.first;
+}
+
+// Values are written as strings, same as boost::property_tree did
+struct JsonValueWriter : public boost::static_visitor<> {
+  JsonValueWriter(std::string& out) : out(out) {}
+  std::string& out;
+
+  void operator()(bool value) const {
+    out += value ? "\"true\"" : "\"false\"";
+  }
+
+  void operator()(unsigned int value) const {
+    out += '"';
+    out += std::to_string(value);
+    out += '"';
+  }
+
+  void operator()(double value) const {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "\"%.17g\"", value);
+    out += buffer;
+  }
+
+  void operator()(const std::string& value) const {
+    appendJsonString(out, value);
   }
 };
 
+// Splits |name| at the dots into |segments|
+void splitKeyName(const std::string& name, std::vector<std::string>& segments) {
+  segments.clear();
+  size_t begin = 0;
+  for (size_t end; (end = name.find('.', begin)) != std::string::npos;
+       begin = end + 1) {
+    segments.push_back(name.substr(begin, end - begin));
+  }
+  segments.push_back(name.substr(begin));
+}
+
 } // namespace
 
-std::string metadataToJsonString(const MetadataPacket& metadata) {
-  boost::property_tree::ptree pt;
-  for (auto pair : metadata) {
-    make_ptree_visitor v(pt, pair.first);
-    boost::apply_visitor(v, pair.second);
+MetadataKey MetadataKey::intern(const std::string& name) {
+  return KeyRegistry::instance().intern(name);
+}
+
+const std::string& MetadataKey::name() const {
+  return KeyRegistry::instance().name(*this);
+}
+
+MetadataItem& MetadataPacket::operator[](MetadataKey key) {
+  auto it = std::lower_bound(
+      entries_.begin(),
+      entries_.end(),
+      Entry(key, MetadataItem()),
+      compareEntryKeys);
+  if (it == entries_.end() || it->first != key) {
+    it = entries_.emplace(it, key, MetadataItem());
+  }
+  return it->second;
+}
+
+const MetadataItem* MetadataPacket::find(MetadataKey key) const {
+  const auto it = std::lower_bound(
+      entries_.begin(),
+      entries_.end(),
+      Entry(key, MetadataItem()),
+      compareEntryKeys);
+  return it != entries_.end() && it->first == key ? &it->second : nullptr;
+}
+
+void MetadataPacket::merge(const MetadataPacket& other) {
+  // Both sides are sorted: append the missing entries and merge the two runs
+  const auto size = entries_.size();
+  auto it = entries_.begin();
+  for (const auto& entry : other.entries_) {
+    const auto end = entries_.begin() + size;
+    it = std::lower_bound(it, end, entry, compareEntryKeys);
+    if (it == end || it->first != entry.first) {
+      const auto offset = it - entries_.begin();
+      entries_.push_back(entry);
+      it = entries_.begin() + offset;
+    }
+  }
+  if (entries_.size() != size) {
+    std::inplace_merge(
+        entries_.begin(),
+        entries_.begin() + size,
+        entries_.end(),
+        compareEntryKeys);
   }
+}
+
+MetadataPacket MetadataPacket::diff(const MetadataPacket& previous) const {
+  MetadataPacket result;
+  auto it = previous.entries_.begin();
+  for (const auto& entry : entries_) {
+    it = std::lower_bound(it, previous.entries_.end(), entry, compareEntryKeys);
+    if (it == previous.entries_.end() || it->first != entry.first ||
+        !(it->second == entry.second)) {
+      result.entries_.push_back(entry);
+    }
+  }
+  return result;
+}
+
+void writeMetadataJson(const MetadataPacket& metadata, std::string& out) {
+  // Entries sorted by name keep the values of each nested object together
+  std::vector<std::pair<const std::string*, const MetadataItem*>> sorted;
+  sorted.reserve(metadata.size());
+  for (const auto& entry : metadata) {
+    sorted.emplace_back(&entry.first.name(), &entry.second);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const auto& e0, const auto& e1) {
+    return *e0.first < *e1.first;
+  });
+
+  // Objects currently open, and whether anything was written to the
+  // innermost one yet
+  std::vector<std::string> path;
+  std::vector<std::string> segments;
+  bool empty = true;
 
-  std::stringstream stream;
-  boost::property_tree::write_json(stream, pt, false);
-  return stream.str();
+  out += '{';
+  for (const auto& entry : sorted) {
+    splitKeyName(*entry.first, segments);
+
+    size_t common = 0;
+    while (common < path.size() && common + 1 < segments.size() &&
+           path[common] == segments[common]) {
+      ++common;
+    }
+    for (; path.size() > common; path.pop_back()) {
+      out += '}';
+      empty = false;
+    }
+    for (; path.size() + 1 < segments.size(); empty = true) {
+      if (!empty) {
+        out += ',';
+      }
+      appendJsonString(out, segments[path.size()]);
+      out += ":{";
+      path.push_back(segments[path.size()]);
+    }
+
+    if (!empty) {
+      out += ',';
+    }
+    appendJsonString(out, segments.back());
+    out += ':';
+    boost::apply_visitor(JsonValueWriter(out), *entry.second);
+    empty = false;
+  }
+  out.append(path.size(), '}');
+  out += "}\n";
+}
+
+std::string metadataToJsonString(const MetadataPacket& metadata) {
+  std::string json;
+  writeMetadataJson(metadata, json);
+  return json;
 }
 
 } // namespace SDR
@@ -8,13 +8,128 @@
 #pragma once
 
 #include <boost/variant.hpp>
+#include <cstdint>
 #include <string>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace SDR {
 
 using MetadataItem = boost::variant<bool, unsigned int, double, std::string>;
-using MetadataPacket = std::unordered_map<std::string, MetadataItem>;
+
+// Interned metadata key. Keys known upfront are compile-time constants, see
+// MetadataKeys, other keys get interned at runtime. Dots in key names nest
+// the values in JSON.
+class MetadataKey final {
+ public:
+  using Id = uint16_t;
+
+  constexpr explicit MetadataKey(Id id) : id_(id) {}
+
+  // Returns the key named |name|, registering it on first use. Thread-safe,
+  // but takes a lock: intern keys once rather than per packet when possible.
+  static MetadataKey intern(const std::string& name);
+
+  // May be called from any thread
+  const std::string& name() const;
+
+  constexpr Id id() const {
+    return id_;
+  }
+
+  constexpr bool operator==(MetadataKey other) const {
+    return id_ == other.id_;
+  }
+
+  constexpr bool operator!=(MetadataKey other) const {
+    return id_ != other.id_;
+  }
+
+  constexpr bool operator<(MetadataKey other) const {
+    return id_ < other.id_;
+  }
+
+ private:
+  Id id_;
+};
+
+namespace MetadataKeys {
+
+constexpr MetadataKey SDRPlayGain{0};
+constexpr MetadataKey SDRPlayRFGainReduction{1};
+constexpr MetadataKey SDRPlayIFGainReduction{2};
+constexpr MetadataKey SDRPlayFreq{3};
+constexpr MetadataKey SDRPlayLNAState{4};
+constexpr MetadataKey SDRPlayNumLNAStates{5};
+constexpr MetadataKey NRSC5BER{6};
+constexpr MetadataKey NRSC5BERAverage{7};
+constexpr MetadataKey NRSC5BERMin{8};
+constexpr MetadataKey NRSC5BERMax{9};
+constexpr MetadataKey NRSC5MERLower{10};
+constexpr MetadataKey NRSC5MERUpper{11};
+constexpr MetadataKey ID3Title{12};
+constexpr MetadataKey ID3Artist{13};
+constexpr MetadataKey ID3Album{14};
+constexpr MetadataKey ID3Genre{15};
+constexpr MetadataKey ID3UFIDOwner{16};
+constexpr MetadataKey ID3UFIDId{17};
+
+constexpr MetadataKey::Id Count = 18;
+
+} // namespace MetadataKeys
+
+// Small flat array of (key, value) entries sorted by key id, so that packets
+// are cheap to build, merge and compare
+class MetadataPacket final {
+ public:
+  using Entry = std::pair<MetadataKey, MetadataItem>;
+  using const_iterator = std::vector<Entry>::const_iterator;
+
+  MetadataPacket() {}
+
+  // Inserts a default value if the packet has no entry for |key|
+  MetadataItem& operator[](MetadataKey key);
+
+  const MetadataItem* find(MetadataKey key) const;
+
+  bool empty() const {
+    return entries_.empty();
+  }
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+  void clear() {
+    entries_.clear();
+  }
+
+  const_iterator begin() const {
+    return entries_.begin();
+  }
+
+  const_iterator end() const {
+    return entries_.end();
+  }
+
+  // Adds the entries of |other| whose keys are not in this packet yet, same
+  // as std::unordered_map::merge()
+  void merge(const MetadataPacket& other);
+
+  // Entries of this packet which are missing from |previous| or differ
+  MetadataPacket diff(const MetadataPacket& previous) const;
+
+  bool operator==(const MetadataPacket& other) const {
+    return entries_ == other.entries_;
+  }
+
+ private:
+  std::vector<Entry> entries_;
+};
+
+// Streams |metadata| as a JSON object to |out|: dotted keys become nested
+// objects and all values are written as strings
+void writeMetadataJson(const MetadataPacket& metadata, std::string& out);
 
 std::string metadataToJsonString(const MetadataPacket& metadata);
 
@@ -7,12 +7,25 @@
 
 #pragma once
 
+#include "BlockPool.hpp"
+#include "Shard.hpp"
+#include "Stats.hpp"
+
+#include <boost/core/demangle.hpp>
 #include <functional>
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
 
 namespace SDR {
 
+class BaseOutput;
+
 class BaseNode {
  public:
   BaseNode() {}
@@ -22,32 +35,288 @@ class BaseNode {
   virtual void reset() = 0;
   virtual void process() = 0;
   virtual void destroy() {}
+
+  virtual void setBlockPool(BlockPool* pool) {}
+
+  // Whether init() starts a source of data, such as a device. Those nodes
+  // are initialized after all the others, which run their init() in parallel.
+  virtual bool initLast() const {
+    return false;
+  }
+
+  // Name used in stats, the node type unless set explicitly
+  std::string name() const;
+  void setName(const std::string& name);
+
+  NodeCounters& counters() {
+    return counters_;
+  }
+
+  const NodeCounters& counters() const {
+    return counters_;
+  }
+
+  // Count samples of the blocks on input and output ports
+  virtual void countInputs() {}
+  virtual void countOutputs() {}
+
+  // Whether reset() has any ports to reset
+  virtual bool needsReset() const {
+    return true;
+  }
+
+  // Whether all connected inputs have data in the current iteration, except
+  // optional ones. Nodes which are not ready are skipped, see OptionalInput.
+  virtual bool isReady() const {
+    return true;
+  }
+
+  // Whether any connected input has a non-empty block in the current
+  // iteration, see isEmptyBlock()
+  virtual bool hasInputData() const {
+    return false;
+  }
+
+  // Whether process() splits its blocks with forEachShard(). Only those nodes
+  // get a shard executor from the graph, see Graph::setSharding().
+  virtual bool isShardable() const {
+    return false;
+  }
+
+  void setShardExecutor(const ShardExecutor* executor) {
+    shardExecutor_ = executor;
+  }
+
+  // Sinks, nodes whose outputs no node reads, tell whether anybody outside
+  // the graph takes their data. Nodes which only feed sinks without
+  // subscribers are pruned, see Graph::refreshDemand().
+  virtual bool hasSubscribers() const {
+    return true;
+  }
+
+  // Whether the graph pruned this node, which it then neither processes nor
+  // keeps initialized. Only changed by the thread running the node.
+  bool isPruned() const {
+    return pruned_;
+  }
+
+  void setPruned(bool pruned) {
+    pruned_ = pruned;
+  }
+
+  // Outputs of this node, and the outputs its inputs are connected to
+  virtual void collectOutputs(std::vector<BaseOutput*>& outputs) {}
+  virtual void collectSources(std::vector<BaseOutput*>& sources) const {}
+
+  // Node running this one from its own process(), which is the one in the
+  // graph, see Fused
+  const BaseNode* enclosingNode() const {
+    return enclosingNode_;
+  }
+
+  void setEnclosingNode(const BaseNode* node) {
+    enclosingNode_ = node;
+  }
+
+ protected:
+  // Calls |fn| for the shards of a block of |size| samples, concurrently if
+  // the graph set up sharding and the block is large enough, otherwise once
+  // for the whole block. See ShardExecutor::run().
+  void forEachShard(
+      size_t size,
+      size_t overlap,
+      ShardExecutor::Function fn) const;
+
+  // Number of shards forEachShard() calls |fn| for, for nodes collecting a
+  // result per shard
+  size_t shardCount(size_t size) const;
+
+  // Upper limit of shardCount(), for nodes sizing their per-shard results
+  // in init()
+  size_t maxShardCount() const;
+
+ private:
+  std::string name_;
+  NodeCounters counters_;
+  const ShardExecutor* shardExecutor_ = nullptr;
+  const BaseNode* enclosingNode_ = nullptr;
+  bool pruned_ = false;
+};
+
+inline std::string BaseNode::name() const {
+  if (!name_.empty()) {
+    return name_;
+  }
+  auto name = boost::core::demangle(typeid(*this).name());
+  constexpr char prefix[] = "SDR::";
+  for (auto pos = name.find(prefix); pos != std::string::npos;
+       pos = name.find(prefix, pos)) {
+    name.erase(pos, sizeof(prefix) - 1);
+  }
+  return name;
+}
+
+inline void BaseNode::setName(const std::string& name) {
+  name_ = name;
+}
+
+inline void BaseNode::forEachShard(
+    size_t size,
+    size_t overlap,
+    ShardExecutor::Function fn) const {
+  if (shardExecutor_) {
+    shardExecutor_->run(size, overlap, fn);
+  } else {
+    fn(Shard{0, 0, size, 0});
+  }
+}
+
+inline size_t BaseNode::shardCount(size_t size) const {
+  return shardExecutor_ ? shardExecutor_->shardCount(size) : 1;
+}
+
+inline size_t BaseNode::maxShardCount() const {
+  return shardExecutor_ ? shardExecutor_->maxShards() : 1;
+}
+
+template <typename T>
+void countBlock(const T& data, size_t& samples, size_t& bytes) {
+  if constexpr (BlockTraits<T>::Poolable) {
+    samples = BlockTraits<T>::size(data);
+    bytes = samples * BlockTraits<T>::ElementSize;
+  } else {
+    samples = 1;
+    bytes = 0;
+  }
+}
+
+template <typename T, typename = void>
+struct HasEmpty : std::false_type {};
+
+template <typename T>
+struct HasEmpty<T, std::void_t<decltype(std::declval<const T&>().empty())>>
+    : std::true_type {};
+
+// Whether |data| carries nothing at all, such as an empty metadata packet
+template <typename T>
+bool isEmptyBlock(const T& data) {
+  if constexpr (HasEmpty<T>::value) {
+    return data.empty();
+  } else {
+    return false;
+  }
+}
+
+// Type-independent part of Output. Outputs nobody reads any more because
+// the graph pruned their consumers are no longer demanded, which lets nodes
+// skip producing optional outputs, such as metadata.
+class BaseOutput {
+ public:
+  bool isDemanded() const {
+    return demanded_;
+  }
+
+  // Only called by the thread running the node
+  void setDemanded(bool demanded) {
+    demanded_ = demanded;
+  }
+
+ private:
+  bool demanded_ = true;
 };
 
 template <typename T>
+class Output;
+
+template <typename T, bool Required = true>
 class Input final {
  public:
   using Type = T;
 
+  constexpr static bool Resettable = false;
+
+  bool isReady() const {
+    return !Required || !dataPtr_ || *dataPtr_;
+  }
+
+  bool hasInput() const {
+    return dataPtr_ && *dataPtr_ && !isEmptyBlock(**dataPtr_);
+  }
+
   Type** dataPtr() const {
     return dataPtr_;
   }
 
-  void setDataPtr(Type** dataPtr) {
-    dataPtr_ = dataPtr;
+  void connect(Output<T>& output) {
+    dataPtr_ = output.getDataPtr();
+    source_ = &output;
+    output.addConsumer();
+  }
+
+  void disconnect() {
+    if (source_) {
+      source_->removeConsumer();
+    }
+    dataPtr_ = nullptr;
+    source_ = nullptr;
+  }
+
+  // Whether this input is the only consumer of the connected output and
+  // the current block is not shared with other subgraphs
+  bool isExclusive() const {
+    return source_ && source_->consumers() == 1 && !source_->isShared();
+  }
+
+  // See Output::share()
+  std::shared_ptr<const T> share() {
+    return source_->share();
   }
 
   void reset() {}
+  void setBlockPool(BlockPool* pool) {}
+
+  void countInput(NodeCounters& counters) const {
+    if (dataPtr_ && *dataPtr_) {
+      size_t samples, bytes;
+      countBlock(**dataPtr_, samples, bytes);
+      counters.countIn(samples, bytes);
+    }
+  }
+
+  void countOutput(NodeCounters& counters) const {}
+
+  void collectOutput(std::vector<BaseOutput*>& outputs) {}
+
+  void collectSource(std::vector<BaseOutput*>& sources) const {
+    if (source_) {
+      sources.push_back(source_);
+    }
+  }
 
  private:
   Type** dataPtr_ = nullptr;
+  Output<T>* source_ = nullptr;
 };
 
+// Input a node processes without, checking hasData() itself
+template <typename T>
+using OptionalInput = Input<T, false>;
+
 template <typename T>
-class Output final {
+class Output final : public BaseOutput {
  public:
   using Type = T;
 
+  constexpr static bool Resettable = true;
+
+  bool isReady() const {
+    return true;
+  }
+
+  bool hasInput() const {
+    return false;
+  }
+
   void storeData(T&& data) {
     if (dataPtr_) {
       throw std::runtime_error("data already stored");
@@ -56,25 +325,128 @@ class Output final {
     dataPtr_ = &data_;
   }
 
+  // Stores a block shared with other subgraphs, which must not be modified
+  void storeShared(std::shared_ptr<const T> data) {
+    if (dataPtr_) {
+      throw std::runtime_error("data already stored");
+    }
+    shared_ = std::move(data);
+    dataPtr_ = const_cast<T*>(shared_.get());
+  }
+
+  // Turns the stored block into an immutable reference-counted one, so that
+  // consumers in other subgraphs can hold on to it without a copy. Consumers
+  // in this subgraph keep reading it through their inputs.
+  std::shared_ptr<const T> share() {
+    if (!dataPtr_) {
+      throw std::runtime_error("no data");
+    }
+    if (!shared_) {
+      shared_ = std::make_shared<T>(std::move(data_));
+      dataPtr_ = const_cast<T*>(shared_.get());
+    }
+    return shared_;
+  }
+
+  bool isShared() const {
+    return shared_ != nullptr;
+  }
+
   Type** getDataPtr() {
     return &dataPtr_;
   }
 
+  void addConsumer() {
+    ++consumers_;
+  }
+
+  void removeConsumer() {
+    --consumers_;
+  }
+
+  size_t consumers() const {
+    return consumers_;
+  }
+
+  T acquireData(size_t capacity) {
+    if constexpr (BlockTraits<T>::Poolable) {
+      if (freeList_) {
+        return freeList_->acquire(capacity);
+      }
+      T data;
+      BlockTraits<T>::reserve(data, capacity);
+      return data;
+    } else {
+      return T();
+    }
+  }
+
+  void recycleData(T&& data) {
+    if constexpr (BlockTraits<T>::Poolable) {
+      if (freeList_) {
+        freeList_->release(std::move(data));
+      }
+    }
+  }
+
   void reset() {
+    // Data stored in the previous iteration is no longer referenced by the
+    // downstream nodes, return it to the pool. Shared blocks are freed by
+    // whichever subgraph lets go of them last instead.
+    if (shared_) {
+      shared_.reset();
+    } else if (dataPtr_) {
+      recycleData(std::move(data_));
+    }
     dataPtr_ = nullptr;
   }
 
+  void setBlockPool(BlockPool* pool) {
+    if constexpr (BlockTraits<T>::Poolable) {
+      freeList_ = pool ? &pool->freeList<T>() : nullptr;
+    }
+  }
+
+  void countInput(NodeCounters& counters) const {}
+
+  void countOutput(NodeCounters& counters) const {
+    if (dataPtr_) {
+      size_t samples, bytes;
+      countBlock(*dataPtr_, samples, bytes);
+      counters.countOut(samples, bytes);
+    }
+  }
+
+  void collectOutput(std::vector<BaseOutput*>& outputs) {
+    outputs.push_back(this);
+  }
+
+  void collectSource(std::vector<BaseOutput*>& sources) const {}
+
  private:
   Type data_;
   Type* dataPtr_ = nullptr;
+  std::shared_ptr<const T> shared_;
+  BlockFreeList<T>* freeList_ = nullptr;
+  size_t consumers_ = 0;
 };
 
 template <typename T>
 class Control final {
  public:
   using Type = T;
+
+  constexpr static bool Resettable = false;
   using ObserverType = std::function<void(const T&)>;
 
+  bool isReady() const {
+    return true;
+  }
+
+  bool hasInput() const {
+    return false;
+  }
+
   const T& value() const {
     return value_;
   }
@@ -101,6 +473,11 @@ class Control final {
   }
 
   void reset() {}
+  void setBlockPool(BlockPool* pool) {}
+  void countInput(NodeCounters& counters) const {}
+  void countOutput(NodeCounters& counters) const {}
+  void collectOutput(std::vector<BaseOutput*>& outputs) {}
+  void collectSource(std::vector<BaseOutput*>& sources) const {}
 
  private:
   Type value_;
@@ -157,11 +534,71 @@ class Node : public BaseNode {
     return **dataPtr;
   };
 
+  template <size_t Idx>
+  bool isExclusive() const {
+    return portAt<Idx>().isExclusive();
+  }
+
+  // Moves the data out of input |Idx|. Only allowed when this node is the
+  // only consumer of the upstream output, see isExclusive().
+  template <size_t Idx>
+  DataType<Idx> takeData() {
+    if (!isExclusive<Idx>()) {
+      throw std::runtime_error("input is shared");
+    }
+    return std::move(getData<Idx>());
+  }
+
+  // In-place contract for nodes producing an output block of the same type
+  // and size as their input: returns the input block itself when this node
+  // is its only consumer, otherwise a new block with room for |capacity|
+  // elements. Element pointers taken from the input block stay valid either
+  // way, so element-wise transforms can read the input and write the output
+  // without caring which one they got.
+  template <size_t InIdx, size_t OutIdx>
+  DataType<OutIdx> takeOrAcquireData(size_t capacity = 0) {
+    if (isExclusive<InIdx>()) {
+      return takeData<InIdx>();
+    }
+    return acquireData<OutIdx>(capacity);
+  }
+
+  // Whether any node still reads output |Idx|, see BaseOutput
+  template <size_t Idx>
+  bool isDemanded() const {
+    return portAt<Idx>().isDemanded();
+  }
+
   template <size_t Idx>
   void setData(DataType<Idx>&& data) {
     portAt<Idx>().storeData(std::move(data));
   };
 
+  // Shares the block on input |Idx| with other subgraphs without copying it,
+  // see Output::share()
+  template <size_t Idx>
+  std::shared_ptr<const DataType<Idx>> shareData() {
+    return portAt<Idx>().share();
+  }
+
+  template <size_t Idx>
+  void setSharedData(std::shared_ptr<const DataType<Idx>> data) {
+    portAt<Idx>().storeShared(std::move(data));
+  }
+
+  // Returns an empty block for output |Idx| with room for at least |capacity|
+  // elements, recycled from the subgraph's block pool when possible.
+  template <size_t Idx>
+  DataType<Idx> acquireData(size_t capacity = 0) {
+    return portAt<Idx>().acquireData(capacity);
+  }
+
+  // Returns an acquired block which ended up not being stored to the pool.
+  template <size_t Idx>
+  void recycleData(DataType<Idx>&& data) {
+    portAt<Idx>().recycleData(std::move(data));
+  }
+
   template <size_t Idx>
   void observe(ObserverType<Idx> observer) {
     portAt<Idx>().observe(observer);
@@ -176,6 +613,50 @@ class Node : public BaseNode {
     std::apply([](auto&... port) { (port.reset(), ...); }, data_);
   }
 
+  virtual bool needsReset() const override {
+    return (Args::Resettable || ...);
+  }
+
+  virtual bool isReady() const override {
+    return std::apply(
+        [](const auto&... port) { return (port.isReady() && ...); }, data_);
+  }
+
+  virtual bool hasInputData() const override {
+    return std::apply(
+        [](const auto&... port) { return (port.hasInput() || ...); }, data_);
+  }
+
+  virtual void setBlockPool(BlockPool* pool) override {
+    std::apply(
+        [pool](auto&... port) { (port.setBlockPool(pool), ...); }, data_);
+  }
+
+  virtual void countInputs() override {
+    std::apply(
+        [this](auto&... port) { (port.countInput(counters()), ...); }, data_);
+  }
+
+  virtual void countOutputs() override {
+    std::apply(
+        [this](auto&... port) { (port.countOutput(counters()), ...); }, data_);
+  }
+
+  virtual void collectOutputs(std::vector<BaseOutput*>& outputs) override {
+    std::apply(
+        [&outputs](auto&... port) { (port.collectOutput(outputs), ...); },
+        data_);
+  }
+
+  virtual void collectSources(
+      std::vector<BaseOutput*>& sources) const override {
+    std::apply(
+        [&sources](const auto&... port) {
+          (port.collectSource(sources), ...);
+        },
+        data_);
+  }
+
  private:
   DataTuple data_;
 };
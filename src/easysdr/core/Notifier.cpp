@@ -0,0 +1,36 @@
+//
+//  Notifier.cpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#include "Notifier.hpp"
+
+namespace SDR {
+
+void Notifier::notify() {
+  if (callback_) {
+    callback_();
+    return;
+  }
+  // Sequentially consistent accesses pair with wait(): either the waiter sees
+  // the pending flag before going to sleep, or we see it waiting
+  pending_.store(true);
+  if (waiting_.load()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    condition_.notify_one();
+  }
+}
+
+void Notifier::wait() {
+  if (pending_.exchange(false)) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  waiting_.store(true);
+  condition_.wait(lock, [this] { return pending_.exchange(false); });
+  waiting_.store(false);
+}
+
+} // namespace SDR
@@ -0,0 +1,53 @@
+//
+//  Notifier.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+namespace SDR {
+
+// Wakes up a subgraph when its input queue receives data or control updates
+// are posted. Notifications are sticky: a notify() issued while the subgraph
+// is busy makes the next wait() return right away, so nothing is missed and
+// no timed polling is needed. The mutex is only taken when the waiting
+// thread is actually asleep.
+class Notifier final {
+ public:
+  using Callback = std::function<void()>;
+
+  Notifier() {}
+
+  Notifier(const Notifier&) = delete;
+  Notifier& operator=(const Notifier&) = delete;
+
+  // Delivers notifications to |callback| instead of waking up wait(), must be
+  // set before the notifier is handed out
+  void setCallback(Callback callback);
+
+  void notify();
+
+  // Blocks until notify() is called, unless it already was since the previous
+  // wait() returned
+  void wait();
+
+ private:
+  std::atomic<bool> pending_{false};
+  std::atomic<bool> waiting_{false};
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  Callback callback_;
+};
+
+inline void Notifier::setCallback(Callback callback) {
+  callback_ = std::move(callback);
+}
+
+} // namespace SDR
@@ -0,0 +1,157 @@
+//
+//  Partition.cpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#include "Partition.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace SDR {
+
+namespace {
+
+constexpr double Infinity = std::numeric_limits<double>::infinity();
+
+// best[k][i]: lowest cost of the most expensive stage when the first i nodes
+// are split into k stages, from[k][i]: where the last one starts
+struct Splits {
+  std::vector<double> prefix;
+  std::vector<std::vector<double>> best;
+  std::vector<std::vector<size_t>> from;
+};
+
+Splits computeSplits(
+    const std::vector<double>& costs,
+    const std::vector<bool>& cuts,
+    size_t maxStages) {
+  const size_t count = costs.size();
+  Splits splits;
+  splits.prefix.assign(count + 1, 0.);
+  for (size_t i = 0; i < count; ++i) {
+    splits.prefix[i + 1] = splits.prefix[i] + costs[i];
+  }
+  splits.best.assign(maxStages + 1, std::vector<double>(count + 1, Infinity));
+  splits.from.assign(maxStages + 1, std::vector<size_t>(count + 1, 0));
+  splits.best[0][0] = 0.;
+  for (size_t k = 1; k <= maxStages; ++k) {
+    for (size_t i = 1; i <= count; ++i) {
+      for (size_t start = i; start-- > 0;) {
+        if (start > 0 && !cuts[start]) {
+          continue;
+        }
+        const double cost = std::max(
+            splits.best[k - 1][start],
+            splits.prefix[i] - splits.prefix[start]);
+        if (cost < splits.best[k][i]) {
+          splits.best[k][i] = cost;
+          splits.from[k][i] = start;
+        }
+      }
+    }
+  }
+  return splits;
+}
+
+std::vector<size_t> stageStarts(const Splits& splits, size_t stageCount) {
+  std::vector<size_t> starts;
+  for (size_t k = stageCount, i = splits.prefix.size() - 1; k > 0;
+       i = splits.from[k--][i]) {
+    starts.insert(starts.begin(), splits.from[k][i]);
+  }
+  return starts;
+}
+
+std::vector<size_t> stagesFromStarts(
+    const std::vector<size_t>& starts,
+    size_t count) {
+  std::vector<size_t> stages(count);
+  for (size_t stage = 0; stage < starts.size(); ++stage) {
+    const size_t end =
+        stage + 1 < starts.size() ? starts[stage + 1] : count;
+    std::fill(stages.begin() + starts[stage], stages.begin() + end, stage);
+  }
+  return stages;
+}
+
+} // namespace
+
+std::vector<size_t> partitionStages(
+    const std::vector<double>& costs,
+    const std::vector<bool>& cuts,
+    size_t maxStages,
+    double minStageCost) {
+  const size_t count = costs.size();
+  if (count == 0) {
+    return {};
+  }
+  maxStages = std::clamp<size_t>(maxStages, 1, count);
+  const auto splits = computeSplits(costs, cuts, maxStages);
+
+  // Fewest stages achieving the lowest cost
+  size_t stageCount = 1;
+  for (size_t k = 2; k <= maxStages; ++k) {
+    if (splits.best[k][count] < splits.best[stageCount][count]) {
+      stageCount = k;
+    }
+  }
+  auto starts = stageStarts(splits, stageCount);
+
+  const auto stageCost = [&](size_t stage) {
+    const size_t end =
+        stage + 1 < starts.size() ? starts[stage + 1] : count;
+    return splits.prefix[end] - splits.prefix[starts[stage]];
+  };
+  while (starts.size() > 1) {
+    size_t cheapest = 0;
+    for (size_t stage = 1; stage < starts.size(); ++stage) {
+      if (stageCost(stage) < stageCost(cheapest)) {
+        cheapest = stage;
+      }
+    }
+    if (stageCost(cheapest) >= minStageCost) {
+      break;
+    }
+    // Dropping the start of a stage merges it into the previous one
+    const bool intoPrevious = cheapest > 0 &&
+        (cheapest + 1 == starts.size() ||
+         stageCost(cheapest - 1) <= stageCost(cheapest + 1));
+    starts.erase(starts.begin() + (intoPrevious ? cheapest : cheapest + 1));
+  }
+  return stagesFromStarts(starts, count);
+}
+
+std::vector<size_t> balanceStages(
+    const std::vector<double>& costs,
+    const std::vector<bool>& cuts,
+    size_t stageCount) {
+  const size_t count = costs.size();
+  if (stageCount == 0 || stageCount > count) {
+    return {};
+  }
+  const auto splits = computeSplits(costs, cuts, stageCount);
+  if (splits.best[stageCount][count] == Infinity) {
+    return {};
+  }
+  return stagesFromStarts(stageStarts(splits, stageCount), count);
+}
+
+double maxStageCost(
+    const std::vector<double>& costs,
+    const std::vector<size_t>& stages) {
+  std::vector<double> stageCosts;
+  for (size_t i = 0; i < costs.size(); ++i) {
+    if (stages[i] >= stageCosts.size()) {
+      stageCosts.resize(stages[i] + 1, 0.);
+    }
+    stageCosts[stages[i]] += costs[i];
+  }
+  return stageCosts.empty()
+      ? 0.
+      : *std::max_element(stageCosts.begin(), stageCosts.end());
+}
+
+} // namespace SDR
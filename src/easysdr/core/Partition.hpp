@@ -0,0 +1,71 @@
+//
+//  Partition.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include "Queue.hpp"
+#include "Stats.hpp"
+
+#include <chrono>
+#include <vector>
+
+namespace SDR {
+
+// Node costs are the share of a CPU core a node keeps busy, the same
+// figure GraphStats yields as process time over uptime
+struct PartitionOptions {
+  // Upper limit of the number of stages a subgraph is split into, the
+  // number of workers of the shared thread pool if 0
+  size_t maxStages = 0;
+  // Stages cheaper than this are merged into a neighbor, so that graphs of
+  // many cheap nodes are not split any further than they pay off
+  double minStageCost = 0.05;
+  // Stats of an earlier run of a graph with the same nodes, matched by name.
+  // Measured costs take precedence over the declared ones.
+  const GraphStats* measured = nullptr;
+  // Options of the queues inserted between stages
+  QueueOptions queue;
+};
+
+// Moving nodes between the stages of a running graph, see
+// Graph::setRebalancing()
+struct RebalanceOptions {
+  // How often stage costs are measured
+  std::chrono::milliseconds interval{2000};
+  // Nodes are only moved if that cuts the cost of the most expensive stage
+  // by at least this fraction, which keeps them from bouncing back and forth
+  double minImprovement = 0.2;
+  // The stages of the pipeline are paused while nodes move, a move is given
+  // up once an input queue of the first stage fills beyond this share of its
+  // capacity, so that blocks arriving meanwhile are not dropped
+  double maxBacklog = 0.5;
+};
+
+// Splits a sequence of nodes with costs |costs| into contiguous stages and
+// returns the stage of every node. A stage may only start at positions
+// |cuts| allows. Uses at most |maxStages| stages and minimizes the cost of
+// the most expensive one, then merges stages cheaper than |minStageCost|
+// into their cheaper neighbor.
+std::vector<size_t> partitionStages(
+    const std::vector<double>& costs,
+    const std::vector<bool>& cuts,
+    size_t maxStages,
+    double minStageCost);
+
+// Splits the same way into exactly |stageCount| stages, without merging any.
+// Returns an empty vector if |cuts| does not allow as many.
+std::vector<size_t> balanceStages(
+    const std::vector<double>& costs,
+    const std::vector<bool>& cuts,
+    size_t stageCount);
+
+// Cost of the most expensive of |stages|
+double maxStageCost(
+    const std::vector<double>& costs,
+    const std::vector<size_t>& stages);
+
+} // namespace SDR
@@ -0,0 +1,39 @@
+//
+//  Priority.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include <cstddef>
+
+namespace SDR {
+
+// How a node fares while the graph is overloaded, see
+// Graph::setOverloadHandling(). Nodes a deferred node feeds see its outputs
+// empty, as if it were starved.
+enum class NodePriority {
+  // Runs every iteration, such as the audio path
+  RealTime,
+  // Only runs in iterations bringing input for it, see
+  // BaseNode::hasInputData(). Work it does on its own, such as publishing
+  // stats every so often, waits. Metadata nodes.
+  Low,
+  // Only runs on every OverloadOptions::decimation-th block, the blocks in
+  // between are dropped. Analysis nodes, such as spectrum or statistics.
+  Background,
+};
+
+struct OverloadOptions {
+  // The graph is overloaded once any input queue fills beyond this share of
+  // its capacity...
+  double highWatermark = 0.5;
+  // ...until all of them drain below this one
+  double lowWatermark = 0.25;
+  // Background nodes only process one block out of this many under overload
+  size_t decimation = 8;
+};
+
+} // namespace SDR
@@ -7,7 +7,11 @@
 
 #pragma once
 
+#include "BlockSequence.hpp"
+#include "Notifier.hpp"
+
 #include <boost/circular_buffer.hpp>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <functional>
@@ -21,6 +25,31 @@ namespace SDR {
 
 class BaseQueue;
 
+// What a queue does with a block pushed while it is full
+enum class QueuePolicy {
+  // The new block is discarded
+  DropNewest,
+  // The oldest block is discarded to make room for the new one, which keeps
+  // the latency of the queue bounded
+  DropOldest,
+  // The producer waits for room up to a timeout, then discards the new block
+  BlockWithTimeout,
+  // The queue takes blocks beyond its size as long as their total size fits
+  // in a byte budget
+  Grow,
+};
+
+struct QueueOptions {
+  QueuePolicy policy = QueuePolicy::DropNewest;
+  // Number of blocks the queue holds before its policy kicks in
+  size_t size = 100;
+  // BlockWithTimeout only
+  std::chrono::milliseconds timeout{10};
+  // Grow only: upper limits of the number of blocks and of their total size
+  size_t maxSize = 1000;
+  size_t maxBytes = 16 * 1024 * 1024;
+};
+
 class BaseQueueObserver {
  public:
   virtual void onDataAvailable(const BaseQueue* queue) = 0;
@@ -34,19 +63,122 @@ class BaseQueue {
   void addObserver(BaseQueueObserver* observer);
   void removeObserver(BaseQueueObserver* observer);
 
+  // Notified on every push, wakes up the consuming subgraph
+  void setNotifier(Notifier* notifier);
+
   virtual bool waitForData(const std::chrono::milliseconds& timeout) = 0;
 
+  virtual size_t size() const = 0;
+  virtual size_t capacity() const = 0;
+
+  // Sequence number of the next block to be popped, consumer side only.
+  // Returns false if the queue is empty or does not carry sequence numbers.
+  virtual bool frontSequence(BlockSequence& sequence) const {
+    return false;
+  }
+
+  // Discards the next block to be popped, consumer side only. Returns false
+  // if the queue is empty or cannot discard blocks.
+  virtual bool discardFront() {
+    return false;
+  }
+
+  // Consumer side: a held queue keeps its blocks for a later iteration of
+  // the consuming subgraph, see Graph::InputReadiness
+  void setHeld(bool held);
+  bool isHeld() const;
+
+  // Whether anybody reads the queue, which makes the graph keep the nodes
+  // feeding it running, see Graph::refreshDemand(). May be called from any
+  // thread.
+  void setSubscribed(bool subscribed);
+  bool isSubscribed() const;
+
+  // Blocks discarded when the queue was full, pops from an empty queue and
+  // the largest number of blocks the queue held, may be read from any thread
+  uint64_t drops() const;
+  uint64_t underruns() const;
+  size_t highWaterMark() const;
+
  protected:
   void notifyDataAvailable();
+  void notifyConsumer();
+
+  void countDrop();
+  void countUnderrun();
+  // Called by the producer after pushing
+  void recordSize(size_t size);
 
  private:
   std::unordered_set<BaseQueueObserver*> observers_;
   std::mutex observersMutex_;
+  std::atomic<Notifier*> notifier_{nullptr};
+  std::atomic<uint64_t> drops_{0};
+  std::atomic<uint64_t> underruns_{0};
+  std::atomic<size_t> highWaterMark_{0};
+  bool held_ = false;
+  std::atomic<bool> subscribed_{true};
 };
 
+inline void BaseQueue::setNotifier(Notifier* notifier) {
+  notifier_.store(notifier, std::memory_order_release);
+}
+
+inline void BaseQueue::notifyConsumer() {
+  if (auto* notifier = notifier_.load(std::memory_order_acquire)) {
+    notifier->notify();
+  }
+}
+
+inline void BaseQueue::setHeld(bool held) {
+  held_ = held;
+}
+
+inline bool BaseQueue::isHeld() const {
+  return held_;
+}
+
+inline void BaseQueue::setSubscribed(bool subscribed) {
+  subscribed_.store(subscribed, std::memory_order_relaxed);
+}
+
+inline bool BaseQueue::isSubscribed() const {
+  return subscribed_.load(std::memory_order_relaxed);
+}
+
+inline uint64_t BaseQueue::drops() const {
+  return drops_.load(std::memory_order_relaxed);
+}
+
+inline uint64_t BaseQueue::underruns() const {
+  return underruns_.load(std::memory_order_relaxed);
+}
+
+inline size_t BaseQueue::highWaterMark() const {
+  return highWaterMark_.load(std::memory_order_relaxed);
+}
+
+inline void BaseQueue::countDrop() {
+  drops_.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void BaseQueue::countUnderrun() {
+  underruns_.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void BaseQueue::recordSize(size_t size) {
+  // Only the producer raises the mark
+  if (size > highWaterMark_.load(std::memory_order_relaxed)) {
+    highWaterMark_.store(size, std::memory_order_relaxed);
+  }
+}
+
 template <typename T>
 class Queue final : public BaseQueue {
  public:
+  constexpr static bool Sequenced = false;
+  constexpr static bool SharedBlocks = false;
+
   Queue(size_t size) : data_(size) {}
 
   virtual bool waitForData(const std::chrono::milliseconds& timeout) override;
@@ -56,6 +188,10 @@ class Queue final : public BaseQueue {
   bool try_push(T&& data);
   bool try_push(const std::shared_ptr<T>& data);
   std::shared_ptr<T> try_pop();
+  bool try_pop(T& data);
+
+  virtual size_t size() const override;
+  virtual size_t capacity() const override;
 
   friend std::ostream& operator<<(std::ostream& os, Queue& queue) {
     std::lock_guard<std::mutex> lock(queue.mutex_);
@@ -66,10 +202,22 @@ class Queue final : public BaseQueue {
 
  private:
   boost::circular_buffer<std::shared_ptr<T>> data_;
-  std::mutex mutex_;
+  mutable std::mutex mutex_;
   std::condition_variable condition_;
 };
 
+template <typename T>
+size_t Queue<T>::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return data_.size();
+}
+
+template <typename T>
+size_t Queue<T>::capacity() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return data_.capacity();
+}
+
 template <typename T>
 bool Queue<T>::waitForData(const std::chrono::milliseconds& timeout) {
   std::unique_lock<std::mutex> lock(mutex_);
@@ -88,31 +236,42 @@ bool Queue<T>::try_push(T&& data) {
 
 template <typename T>
 void Queue<T>::push(const std::shared_ptr<T>& data) {
+  bool was_empty;
   {
     std::lock_guard<std::mutex> lock(mutex_);
-    bool was_empty = data_.empty();
-    data_.push_back(data);
-    if (!was_empty) {
-      return;
+    was_empty = data_.empty();
+    // The circular buffer overwrites the oldest block when full
+    if (data_.full()) {
+      countDrop();
     }
+    data_.push_back(data);
+    recordSize(data_.size());
+    condition_.notify_one();
+  }
+  notifyConsumer();
+  if (was_empty) {
+    notifyDataAvailable();
   }
-  notifyDataAvailable();
 }
 
 template <typename T>
 bool Queue<T>::try_push(const std::shared_ptr<T>& data) {
+  bool was_empty;
   {
     std::lock_guard<std::mutex> lock(mutex_);
     if (data_.full()) {
+      countDrop();
       return false;
     }
-    bool was_empty = data_.empty();
+    was_empty = data_.empty();
     data_.push_back(data);
-    if (!was_empty) {
-      return true;
-    }
+    recordSize(data_.size());
+    condition_.notify_one();
+  }
+  notifyConsumer();
+  if (was_empty) {
+    notifyDataAvailable();
   }
-  notifyDataAvailable();
   return true;
 }
 
@@ -127,4 +286,20 @@ std::shared_ptr<T> Queue<T>::try_pop() {
   return temp;
 }
 
+template <typename T>
+bool Queue<T>::try_pop(T& data) {
+  const auto ptr = try_pop();
+  if (!ptr) {
+    countUnderrun();
+    return false;
+  }
+  // Blocks pushed as shared pointers may still be referenced elsewhere
+  if (ptr.use_count() == 1) {
+    data = std::move(*ptr);
+  } else {
+    data = *ptr;
+  }
+  return true;
+}
+
 } // namespace SDR
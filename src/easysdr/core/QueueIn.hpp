@@ -10,30 +10,60 @@
 #include "Node.hpp"
 #include "Queue.hpp"
 
-#include <iostream>
-
 namespace SDR {
 
-template <typename DataType>
+template <typename DataType, class QueueT = Queue<DataType>>
 class QueueIn final : public Node<Output<DataType>> {
  public:
-  using QueueType = Queue<DataType>;
+  using QueueType = QueueT;
 
   QueueIn(QueueType& queue) : queue_(queue) {}
 
   enum { OUT_OUTPUT = 0 };
 
   virtual void process() override {
-    auto dataPtr = queue_.try_pop();
-    if (!dataPtr) {
-      std::cerr << "Queue is empty: " << queue_ << std::endl << std::endl;
+    if (queue_.isHeld()) {
       return;
     }
-    this->template setData<OUT_OUTPUT>(std::move(*dataPtr));
+    // The spare block is handed over to the queue in exchange for the data
+    auto data = this->template acquireData<OUT_OUTPUT>(lastSize_);
+    if constexpr (QueueType::SharedBlocks) {
+      std::shared_ptr<const DataType> shared;
+      // Underruns are counted by the queue
+      if (!queue_.try_pop(data, shared)) {
+        this->template recycleData<OUT_OUTPUT>(std::move(data));
+        return;
+      }
+      if (shared) {
+        // Downstream nodes see the block as not exclusive and copy it if
+        // they need to modify it
+        this->template recycleData<OUT_OUTPUT>(std::move(data));
+        lastSize_ = blockSize(*shared);
+        this->template setSharedData<OUT_OUTPUT>(std::move(shared));
+        return;
+      }
+    } else {
+      if (!queue_.try_pop(data)) {
+        this->template recycleData<OUT_OUTPUT>(std::move(data));
+        return;
+      }
+    }
+    lastSize_ = blockSize(data);
+    this->template setData<OUT_OUTPUT>(std::move(data));
+  }
+
+ private:
+  static size_t blockSize(const DataType& data) {
+    if constexpr (BlockTraits<DataType>::Poolable) {
+      return data.size();
+    } else {
+      return 0;
+    }
   }
 
  private:
   QueueType& queue_;
+  size_t lastSize_ = 0;
 };
 
 } // namespace SDR
@@ -7,44 +7,85 @@
 
 #pragma once
 
+#include "BlockSequence.hpp"
 #include "Node.hpp"
 #include "Queue.hpp"
 
-#include <iostream>
+#include <type_traits>
 
 namespace SDR {
 
-template <typename DataType>
+template <typename DataType, class QueueT = Queue<DataType>>
 class QueueOut final
-    : public Node<Input<DataType>, Input<std::vector<DataType>>> {
+    : public Node<
+          OptionalInput<DataType>,
+          OptionalInput<std::vector<DataType>>> {
  public:
-  using QueueType = Queue<DataType>;
+  using QueueType = QueueT;
 
   QueueOut(QueueType& queue) : queue_(queue) {}
 
   enum { IN_INPUT = 0, IN_INPUT_VECTOR };
 
+  virtual bool hasSubscribers() const override {
+    return queue_.isSubscribed();
+  }
+
   virtual void process() override {
     if (this->template isConnected<IN_INPUT>() &&
         this->template hasData<IN_INPUT>()) {
-      auto& inData = this->template getData<IN_INPUT>();
-      if (!queue_.try_push(std::move(inData))) {
-        std::cerr << "Queue is full, discarding data: " << queue_ << std::endl;
-      }
+      pushInput();
     }
     if (this->template isConnected<IN_INPUT_VECTOR>() &&
         this->template hasData<IN_INPUT_VECTOR>()) {
       auto& inDataVec = this->template getData<IN_INPUT_VECTOR>();
-      for (auto& inData : inDataVec) {
-        if (!queue_.try_push(std::move(inData))) {
-          std::cerr << "Queue is full, discarding data: " << queue_
-                    << std::endl;
-          break;
+      const bool exclusive = this->template isExclusive<IN_INPUT_VECTOR>();
+      for (auto&& inData : inDataVec) {
+        if constexpr (std::is_lvalue_reference_v<decltype(inData)>) {
+          push(inData, exclusive);
+        } else {
+          // Proxies, such as the elements of std::vector<bool>, are copied
+          DataType copy(inData);
+          push(copy, true);
         }
       }
     }
   }
 
+ private:
+  void pushInput() {
+    const bool exclusive = this->template isExclusive<IN_INPUT>();
+    if constexpr (QueueType::SharedBlocks) {
+      // Blocks read by other nodes or queues are shared instead of copied
+      if (!exclusive) {
+        queue_.push(
+            this->template shareData<IN_INPUT>(), currentBlockSequence());
+        return;
+      }
+    }
+    push(this->template getData<IN_INPUT>(), exclusive);
+  }
+
+  // Data is only moved into the queue when no other node reads it. Moved
+  // data is left holding whatever the queue hands back, which the upstream
+  // output recycles on its next reset(). Blocks discarded by a full queue
+  // are counted by the queue.
+  bool push(DataType& data, bool exclusive) {
+    if (exclusive) {
+      return pushToQueue(std::move(data));
+    }
+    DataType copy(data);
+    return pushToQueue(std::move(copy));
+  }
+
+  bool pushToQueue(DataType&& data) {
+    if constexpr (QueueType::Sequenced) {
+      return queue_.push(std::move(data), currentBlockSequence());
+    } else {
+      return queue_.try_push(std::move(data));
+    }
+  }
+
  private:
   QueueType& queue_;
 };
@@ -0,0 +1,416 @@
+//
+//  SPSCQueue.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include "BlockPool.hpp"
+#include "BlockSequence.hpp"
+#include "Queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace SDR {
+
+// Wait-free single-producer/single-consumer ring queue. Blocks are held by
+// value in slots preallocated at construction, so neither push nor pop
+// allocates or locks. The mutex is only taken by a consumer blocked in
+// waitForData() and by a producer waking such a consumer up.
+//
+// Push and pop swap blocks with the slots instead of overwriting them: the
+// consumer hands its spare block to the slot it pops from and the producer
+// gets it back on its next push to that slot, so buffers travel back to the
+// producer's block pool instead of being freed on the consumer thread.
+//
+// Blocks shared with other subgraphs are passed by reference instead, and
+// are never modified by the consumer.
+//
+// Every block travels with the sequence number it was pushed with.
+//
+// The ring is sized for the queue policy, Grow makes room for the maximum
+// number of blocks. Under DropOldest a producer finding the ring full
+// advances the head past the oldest block, so the head is claimed with a CAS
+// by both sides and the consumer publishes the slot it is reading. The only
+// block dropped on push is one that would go to that slot, while the
+// consumer is still reading it.
+template <typename T>
+class SPSCQueue final : public BaseQueue {
+ public:
+  constexpr static bool Sequenced = true;
+  constexpr static bool SharedBlocks = true;
+
+  SPSCQueue(size_t size) : SPSCQueue(QueueOptions{.size = size}) {}
+  SPSCQueue(const QueueOptions& options);
+
+  virtual bool waitForData(const std::chrono::milliseconds& timeout) override;
+
+  // Producer side, returns false if the queue policy discarded the block
+  bool push(T&& data, BlockSequence sequence);
+  bool push(std::shared_ptr<const T> data, BlockSequence sequence);
+
+  // Consumer side. A shared block is returned through |shared| if given,
+  // otherwise copied into |data|.
+  bool try_pop(T& data);
+  bool try_pop(T& data, std::shared_ptr<const T>& shared);
+  virtual bool frontSequence(BlockSequence& sequence) const override;
+  virtual bool discardFront() override;
+
+  bool empty() const;
+  virtual size_t size() const override;
+  virtual size_t capacity() const override;
+
+  friend std::ostream& operator<<(std::ostream& os, const SPSCQueue& queue) {
+    os << "SPSCQueue type:" << typeid(T).name() << " size: " << queue.size()
+       << " capacity: " << queue.capacity();
+    return os;
+  }
+
+ private:
+  struct Slot;
+
+  // |store| moves the block into a slot
+  template <typename Store>
+  bool pushBlock(size_t bytes, BlockSequence sequence, Store&& store);
+  template <typename Store>
+  bool tryPush(size_t bytes, BlockSequence sequence, Store& store);
+  bool waitForRoom();
+  size_t next(size_t index) const;
+  size_t count(size_t head, size_t tail) const;
+  bool dropOldest(size_t tail, size_t& head);
+  bool full() const;
+  static size_t ringSize(const QueueOptions& options);
+  static size_t blockBytes(const T& data);
+
+ private:
+  constexpr static size_t CacheLineSize = 64;
+  constexpr static size_t NoSlot = std::numeric_limits<size_t>::max();
+
+  struct Slot {
+    T data;
+    std::shared_ptr<const T> shared;
+    BlockSequence sequence = 0;
+    // Grow only
+    size_t bytes = 0;
+  };
+
+  const QueueOptions options_;
+  std::vector<Slot> slots_;
+  alignas(CacheLineSize) std::atomic<size_t> head_{0};
+  alignas(CacheLineSize) std::atomic<size_t> tail_{0};
+  // DropOldest only, the slot the consumer reads from
+  alignas(CacheLineSize) mutable std::atomic<size_t> reading_{NoSlot};
+  alignas(CacheLineSize) std::atomic<bool> waiting_{false};
+  std::atomic<bool> producerWaiting_{false};
+  // Grow only
+  std::atomic<size_t> bytes_{0};
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::condition_variable roomCondition_;
+};
+
+template <typename T>
+SPSCQueue<T>::SPSCQueue(const QueueOptions& options)
+    : options_(options), slots_(ringSize(options) + 1) {}
+
+template <typename T>
+size_t SPSCQueue<T>::ringSize(const QueueOptions& options) {
+  switch (options.policy) {
+    case QueuePolicy::Grow:
+      return std::max(options.size, options.maxSize);
+    default:
+      return options.size;
+  }
+}
+
+template <typename T>
+size_t SPSCQueue<T>::blockBytes(const T& data) {
+  if constexpr (BlockTraits<T>::Poolable) {
+    return BlockTraits<T>::size(data) * BlockTraits<T>::ElementSize;
+  } else {
+    return sizeof(T);
+  }
+}
+
+template <typename T>
+inline size_t SPSCQueue<T>::next(size_t index) const {
+  return index + 1 == slots_.size() ? 0 : index + 1;
+}
+
+template <typename T>
+inline size_t SPSCQueue<T>::count(size_t head, size_t tail) const {
+  return tail >= head ? tail - head : tail + slots_.size() - head;
+}
+
+template <typename T>
+inline bool SPSCQueue<T>::full() const {
+  return next(tail_.load(std::memory_order_relaxed)) == head_.load();
+}
+
+template <typename T>
+inline bool SPSCQueue<T>::empty() const {
+  return head_.load(std::memory_order_acquire) ==
+      tail_.load(std::memory_order_acquire);
+}
+
+template <typename T>
+inline size_t SPSCQueue<T>::size() const {
+  const size_t head = head_.load(std::memory_order_acquire);
+  const size_t tail = tail_.load(std::memory_order_acquire);
+  return count(head, tail);
+}
+
+template <typename T>
+inline size_t SPSCQueue<T>::capacity() const {
+  return options_.size;
+}
+
+template <typename T>
+bool SPSCQueue<T>::waitForData(const std::chrono::milliseconds& timeout) {
+  if (!empty()) {
+    return true;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  waiting_.store(true);
+  const bool ready =
+      condition_.wait_for(lock, timeout, [this] { return !empty(); });
+  waiting_.store(false);
+  return ready;
+}
+
+template <typename T>
+bool SPSCQueue<T>::push(T&& data, BlockSequence sequence) {
+  return pushBlock(blockBytes(data), sequence, [&data](Slot& slot) {
+    std::swap(slot.data, data);
+    slot.shared.reset();
+  });
+}
+
+template <typename T>
+bool SPSCQueue<T>::push(std::shared_ptr<const T> data, BlockSequence sequence) {
+  return pushBlock(blockBytes(*data), sequence, [&data](Slot& slot) {
+    slot.shared = std::move(data);
+  });
+}
+
+template <typename T>
+template <typename Store>
+bool SPSCQueue<T>::pushBlock(
+    size_t bytes,
+    BlockSequence sequence,
+    Store&& store) {
+  switch (options_.policy) {
+    case QueuePolicy::BlockWithTimeout:
+      if (tryPush(bytes, sequence, store) ||
+          (waitForRoom() && tryPush(bytes, sequence, store))) {
+        return true;
+      }
+      break;
+    case QueuePolicy::Grow:
+      if (size() >= options_.size &&
+          bytes_.load(std::memory_order_relaxed) + bytes > options_.maxBytes) {
+        break;
+      }
+      if (tryPush(bytes, sequence, store)) {
+        return true;
+      }
+      break;
+    default:
+      if (tryPush(bytes, sequence, store)) {
+        return true;
+      }
+      break;
+  }
+  countDrop();
+  return false;
+}
+
+template <typename T>
+bool SPSCQueue<T>::waitForRoom() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  producerWaiting_.store(true);
+  const bool ready = roomCondition_.wait_for(
+      lock, options_.timeout, [this] { return !full(); });
+  producerWaiting_.store(false);
+  return ready;
+}
+
+template <typename T>
+template <typename Store>
+bool SPSCQueue<T>::tryPush(size_t bytes, BlockSequence sequence, Store& store) {
+  const size_t tail = tail_.load(std::memory_order_relaxed);
+  const size_t nextTail = next(tail);
+  size_t head = head_.load(std::memory_order_acquire);
+  if (nextTail == head) {
+    if (options_.policy != QueuePolicy::DropOldest ||
+        !dropOldest(tail, head)) {
+      return false;
+    }
+  }
+  auto& slot = slots_[tail];
+  if (options_.policy == QueuePolicy::Grow) {
+    slot.bytes = bytes;
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  }
+  store(slot);
+  slot.sequence = sequence;
+  // Sequentially consistent store pairs with the waiting_ flag: either the
+  // consumer sees the new tail before going to sleep, or we see it waiting.
+  tail_.store(nextTail);
+  recordSize(count(head, nextTail));
+  if (waiting_.load()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    condition_.notify_one();
+  }
+  notifyConsumer();
+  // Observers are notified when the block is the only one in the queue after
+  // publishing it. Checking the head after the tail store means a consumer
+  // draining the queue concurrently either sees this block or gets notified.
+  if (head_.load() == tail) {
+    notifyDataAvailable();
+  }
+  return true;
+}
+
+template <typename T>
+bool SPSCQueue<T>::dropOldest(size_t tail, size_t& head) {
+  // The consumer may claim the oldest block first, which makes room as well.
+  // Sequentially consistent loads pair with the consumer publishing the slot
+  // it reads before claiming it.
+  while (next(tail) == head) {
+    if (reading_.load() == tail) {
+      return false;
+    }
+    if (head_.compare_exchange_weak(head, next(head))) {
+      // The block stays in its slot and goes back to us with a later push
+      head = next(head);
+      countDrop();
+    }
+  }
+  return true;
+}
+
+template <typename T>
+bool SPSCQueue<T>::try_pop(T& data) {
+  std::shared_ptr<const T> shared;
+  if (!try_pop(data, shared)) {
+    return false;
+  }
+  if (shared) {
+    data = *shared;
+  }
+  return true;
+}
+
+template <typename T>
+bool SPSCQueue<T>::try_pop(T& data, std::shared_ptr<const T>& shared) {
+  const auto take = [&data, &shared](Slot& slot) {
+    if (slot.shared) {
+      shared = std::move(slot.shared);
+    } else {
+      std::swap(data, slot.data);
+    }
+  };
+
+  if (options_.policy == QueuePolicy::DropOldest) {
+    // Claims the oldest block before reading it, racing the producer
+    // dropping it
+    size_t head = head_.load();
+    while (true) {
+      if (head == tail_.load(std::memory_order_acquire)) {
+        reading_.store(NoSlot);
+        countUnderrun();
+        return false;
+      }
+      reading_.store(head);
+      if (head_.compare_exchange_weak(head, next(head))) {
+        break;
+      }
+    }
+    take(slots_[head]);
+    reading_.store(NoSlot);
+    return true;
+  }
+
+  const size_t tail = tail_.load(std::memory_order_acquire);
+  const size_t head = head_.load(std::memory_order_relaxed);
+  if (head == tail) {
+    countUnderrun();
+    return false;
+  }
+  auto& slot = slots_[head];
+  take(slot);
+  if (options_.policy == QueuePolicy::Grow) {
+    bytes_.fetch_sub(slot.bytes, std::memory_order_relaxed);
+  }
+  if (options_.policy != QueuePolicy::BlockWithTimeout) {
+    head_.store(next(head), std::memory_order_release);
+    return true;
+  }
+  // Sequentially consistent store pairs with the producerWaiting_ flag, same
+  // as the tail and the waiting_ flag on the other side
+  head_.store(next(head));
+  if (producerWaiting_.load()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    roomCondition_.notify_one();
+  }
+  return true;
+}
+
+template <typename T>
+bool SPSCQueue<T>::frontSequence(BlockSequence& sequence) const {
+  if (options_.policy == QueuePolicy::DropOldest) {
+    // Holds the front slot while reading it, same as try_pop()
+    size_t head = head_.load();
+    while (true) {
+      if (head == tail_.load(std::memory_order_acquire)) {
+        reading_.store(NoSlot);
+        return false;
+      }
+      reading_.store(head);
+      const size_t current = head_.load();
+      if (current == head) {
+        break;
+      }
+      head = current;
+    }
+    sequence = slots_[head].sequence;
+    reading_.store(NoSlot);
+    return true;
+  }
+
+  const size_t tail = tail_.load(std::memory_order_acquire);
+  const size_t head = head_.load(std::memory_order_relaxed);
+  if (head == tail) {
+    return false;
+  }
+  sequence = slots_[head].sequence;
+  return true;
+}
+
+template <typename T>
+bool SPSCQueue<T>::discardFront() {
+  if (empty()) {
+    return false;
+  }
+  // Popped like any other block, the slot gets an empty block in exchange
+  T data;
+  std::shared_ptr<const T> shared;
+  try_pop(data, shared);
+  countDrop();
+  return true;
+}
+
+} // namespace SDR
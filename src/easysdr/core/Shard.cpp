@@ -0,0 +1,161 @@
+//
+//  Shard.cpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#include "Shard.hpp"
+
+#include "AllocationGuard.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace SDR {
+
+// Shards of one block, claimed one at a time by the calling thread and the
+// pool tasks helping it. Tasks may run after all shards are claimed, so the
+// job only goes back to the executor once the caller and every task are
+// done with it.
+struct ShardExecutor::Job {
+  explicit Job(const ShardExecutor& executor) : executor(executor) {}
+
+  const ShardExecutor& executor;
+  const Function* fn = nullptr;
+  size_t size = 0;
+  size_t overlap = 0;
+  size_t count = 0;
+  // Allocations made by shards are charged to the caller's scope
+  AllocationScope* scope = nullptr;
+  std::atomic<size_t> next{0};
+  // The caller and the tasks still to finish
+  std::atomic<size_t> users{0};
+  size_t done = 0;
+  std::exception_ptr error;
+  std::mutex mutex;
+  std::condition_variable condition;
+
+  void start(
+      const Function& blockFn,
+      size_t blockSize,
+      size_t overlapSize,
+      size_t shardCount) {
+    fn = &blockFn;
+    size = blockSize;
+    overlap = overlapSize;
+    count = shardCount;
+    scope = AllocationScope::current();
+    next = 0;
+    users = shardCount;
+    done = 0;
+    error = nullptr;
+  }
+
+  // Processes shards until none are left unclaimed. |fn| is only called for
+  // a claimed shard, and the caller waits for those.
+  void work() {
+    for (size_t index = next++; index < count; index = next++) {
+      Shard shard;
+      shard.index = index;
+      shard.begin = size * index / count;
+      shard.end = size * (index + 1) / count;
+      shard.historyBegin = shard.begin - std::min(shard.begin, overlap);
+      std::exception_ptr shardError;
+      try {
+        ForwardedAllocationScope allocations(scope);
+        (*fn)(shard);
+      } catch (...) {
+        shardError = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      if (shardError && !error) {
+        error = shardError;
+      }
+      if (++done == count) {
+        condition.notify_all();
+      }
+    }
+  }
+
+  void release() {
+    if (--users == 0) {
+      executor.releaseJob(this);
+    }
+  }
+};
+
+ShardExecutor::ShardExecutor(ThreadPool& pool, const ShardOptions& options)
+    : pool_(pool), options_(options) {}
+
+ShardExecutor::~ShardExecutor() {
+  std::unique_lock<std::mutex> lock(jobsMutex_);
+  jobsCondition_.wait(
+      lock, [this] { return freeJobs_.size() == jobs_.size(); });
+}
+
+size_t ShardExecutor::shardCount(size_t size) const {
+  const size_t count = size / std::max<size_t>(options_.minShardSize, 1);
+  return std::max<size_t>(std::min(count, maxShards()), 1);
+}
+
+size_t ShardExecutor::maxShards() const {
+  return options_.maxShards ? options_.maxShards : pool_.threadCount();
+}
+
+void ShardExecutor::run(size_t size, size_t overlap, Function fn) const {
+  const size_t count = shardCount(size);
+  if (count == 1) {
+    fn(Shard{0, 0, size, 0});
+    return;
+  }
+
+  auto* job = acquireJob();
+  job->start(fn, size, overlap, count);
+  for (size_t helper = 1; helper < count; ++helper) {
+    // A plain pointer fits the inline storage of the pool's std::function
+    pool_.submit([job]() {
+      job->work();
+      job->release();
+    });
+  }
+  job->work();
+
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->condition.wait(lock, [job] { return job->done == job->count; });
+    error = job->error;
+  }
+  job->release();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+ShardExecutor::Job* ShardExecutor::acquireJob() const {
+  std::lock_guard<std::mutex> lock(jobsMutex_);
+  if (freeJobs_.empty()) {
+    jobs_.push_back(std::make_unique<Job>(*this));
+    // Released jobs never make the free list grow
+    freeJobs_.reserve(jobs_.size());
+    return jobs_.back().get();
+  }
+  auto* job = freeJobs_.back();
+  freeJobs_.pop_back();
+  return job;
+}
+
+void ShardExecutor::releaseJob(Job* job) const {
+  std::lock_guard<std::mutex> lock(jobsMutex_);
+  freeJobs_.push_back(job);
+  // Notified under the lock, the destructor may be waiting to return
+  jobsCondition_.notify_all();
+}
+
+} // namespace SDR
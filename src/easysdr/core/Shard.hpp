@@ -0,0 +1,108 @@
+//
+//  Shard.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace SDR {
+
+class ThreadPool;
+
+struct ShardOptions {
+  // Blocks are only split into shards of at least this many samples, so that
+  // the handoff to other workers does not cost more than it saves
+  size_t minShardSize = 8192;
+  // Upper limit of the number of shards of a block, the number of workers of
+  // the thread pool if 0
+  size_t maxShards = 0;
+};
+
+// Range of samples of a block processed by one worker. Nodes keeping a short
+// history, such as FIR filters, start from |historyBegin| to warm up their
+// state and only produce output for [begin, end).
+struct Shard {
+  size_t index;
+  size_t begin;
+  size_t end;
+  size_t historyBegin;
+};
+
+// Processes the samples of one block on several workers of a thread pool,
+// see BaseNode::isShardable()
+class ShardExecutor final {
+ public:
+  // Reference to the callable processing a shard, which must outlive the
+  // call taking it. Unlike std::function it never allocates.
+  class Function final {
+   public:
+    template <
+        class F,
+        class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Function>>>
+    Function(const F& fn) : object_(&fn), call_(&call<F>) {}
+
+    void operator()(const Shard& shard) const {
+      call_(object_, shard);
+    }
+
+   private:
+    template <class F>
+    static void call(const void* object, const Shard& shard) {
+      (*static_cast<const F*>(object))(shard);
+    }
+
+   private:
+    const void* object_;
+    void (*call_)(const void*, const Shard&);
+  };
+
+  ShardExecutor(ThreadPool& pool, const ShardOptions& options);
+
+  // Waits for the pool tasks still holding on to jobs
+  ~ShardExecutor();
+
+  ShardExecutor(const ShardExecutor&) = delete;
+  ShardExecutor& operator=(const ShardExecutor&) = delete;
+
+  // Number of shards a block of |size| samples is split into
+  size_t shardCount(size_t size) const;
+
+  // Upper limit of shardCount() for any block size
+  size_t maxShards() const;
+
+  // Calls |fn| for every shard of a block of |size| samples, where every
+  // shard but the first gets up to |overlap| samples of history, and returns
+  // once all of them are done. Shards cover the block in order without
+  // gaps, so nodes writing the output of every shard to its own range of an
+  // output block of the same size get the results concatenated. The calling
+  // thread processes shards as well, it never waits for a task still queued
+  // on the pool. Rethrows the first exception thrown by |fn|.
+  void run(size_t size, size_t overlap, Function fn) const;
+
+ private:
+  struct Job;
+
+  Job* acquireJob() const;
+  void releaseJob(Job* job) const;
+
+ private:
+  ThreadPool& pool_;
+  const ShardOptions options_;
+  // Jobs are reused, so that sharding a block only allocates until every
+  // node running concurrently got a job of its own
+  mutable std::mutex jobsMutex_;
+  mutable std::condition_variable jobsCondition_;
+  mutable std::vector<std::unique_ptr<Job>> jobs_;
+  mutable std::vector<Job*> freeJobs_;
+};
+
+} // namespace SDR
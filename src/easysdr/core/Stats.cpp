@@ -0,0 +1,98 @@
+//
+//  Stats.cpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#include "Stats.hpp"
+
+namespace SDR {
+
+void NodeCounters::recordProcess(std::chrono::steady_clock::duration duration) {
+  const auto nanos =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  auto micros = static_cast<uint64_t>(nanos) / 1000;
+  size_t bucket = 0;
+  while (micros && bucket + 1 < ProcessTimeBuckets) {
+    micros >>= 1;
+    ++bucket;
+  }
+  add(calls_, 1);
+  add(processNanos_, static_cast<uint64_t>(nanos));
+  add(histogram_[bucket], 1);
+}
+
+void NodeCounters::recordInit(
+    std::chrono::steady_clock::duration start,
+    std::chrono::steady_clock::duration duration) {
+  using std::chrono::duration_cast;
+  using std::chrono::nanoseconds;
+  initStartNanos_.store(
+      static_cast<uint64_t>(duration_cast<nanoseconds>(start).count()),
+      std::memory_order_relaxed);
+  initNanos_.store(
+      static_cast<uint64_t>(duration_cast<nanoseconds>(duration).count()),
+      std::memory_order_relaxed);
+}
+
+void NodeCounters::snapshot(NodeStats& stats) const {
+  stats.calls = calls_.load(std::memory_order_relaxed);
+  stats.processNanos = processNanos_.load(std::memory_order_relaxed);
+  for (size_t bucket = 0; bucket < ProcessTimeBuckets; ++bucket) {
+    stats.processTimeHistogram[bucket] =
+        histogram_[bucket].load(std::memory_order_relaxed);
+  }
+  stats.samplesIn = samplesIn_.load(std::memory_order_relaxed);
+  stats.bytesIn = bytesIn_.load(std::memory_order_relaxed);
+  stats.samplesOut = samplesOut_.load(std::memory_order_relaxed);
+  stats.bytesOut = bytesOut_.load(std::memory_order_relaxed);
+  stats.initStartNanos = initStartNanos_.load(std::memory_order_relaxed);
+  stats.initNanos = initNanos_.load(std::memory_order_relaxed);
+  stats.allocations = allocations_.load(std::memory_order_relaxed);
+  stats.deferrals = deferrals_.load(std::memory_order_relaxed);
+}
+
+void NodeCounters::clear() {
+  calls_ = 0;
+  processNanos_ = 0;
+  for (auto& bucket : histogram_) {
+    bucket = 0;
+  }
+  samplesIn_ = 0;
+  bytesIn_ = 0;
+  samplesOut_ = 0;
+  bytesOut_ = 0;
+  initStartNanos_ = 0;
+  initNanos_ = 0;
+  allocations_ = 0;
+  deferrals_ = 0;
+}
+
+void QueueCounters::sample(size_t size) {
+  samples_.store(
+      samples_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  sizeSum_.store(
+      sizeSum_.load(std::memory_order_relaxed) + size,
+      std::memory_order_relaxed);
+  if (size > maxSize_.load(std::memory_order_relaxed)) {
+    maxSize_.store(size, std::memory_order_relaxed);
+  }
+}
+
+void QueueCounters::snapshot(QueueStats& stats) const {
+  const auto samples = samples_.load(std::memory_order_relaxed);
+  stats.maxSize = maxSize_.load(std::memory_order_relaxed);
+  stats.averageSize = samples
+      ? static_cast<double>(sizeSum_.load(std::memory_order_relaxed)) /
+          static_cast<double>(samples)
+      : 0.;
+}
+
+void QueueCounters::clear() {
+  samples_ = 0;
+  sizeSum_ = 0;
+  maxSize_ = 0;
+}
+
+} // namespace SDR
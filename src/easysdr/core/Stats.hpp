@@ -0,0 +1,160 @@
+//
+//  Stats.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace SDR {
+
+// Log2 histogram of process() durations: bucket 0 counts calls under 1us,
+// bucket i calls within [2^(i-1), 2^i) us and the last one everything longer.
+constexpr size_t ProcessTimeBuckets = 16;
+
+struct NodeStats {
+  std::string name;
+  // Index in GraphStats::subgraphs
+  size_t subgraph = 0;
+  uint64_t calls = 0;
+  uint64_t processNanos = 0;
+  std::array<uint64_t, ProcessTimeBuckets> processTimeHistogram{};
+  uint64_t samplesIn = 0;
+  uint64_t bytesIn = 0;
+  uint64_t samplesOut = 0;
+  uint64_t bytesOut = 0;
+  // Start-up timeline: when init() was called, relative to
+  // Graph::startRunning(), and how long it took
+  uint64_t initStartNanos = 0;
+  uint64_t initNanos = 0;
+  // Heap allocations made by process() since Graph::guardAllocations()
+  uint64_t allocations = 0;
+  // Iterations the node sat out while the graph was overloaded, see
+  // NodePriority
+  uint64_t deferrals = 0;
+};
+
+struct QueueStats {
+  std::string name;
+  size_t size = 0;
+  size_t capacity = 0;
+  size_t maxSize = 0;
+  double averageSize = 0.;
+  // Counted by the queue itself since it was created
+  size_t highWaterMark = 0;
+  uint64_t drops = 0;
+  uint64_t underruns = 0;
+};
+
+// Connection between two nodes, through a queue when they run in different
+// subgraphs
+struct EdgeStats {
+  std::string from;
+  std::string to;
+  bool queued = false;
+  // Name of the queue in GraphStats::queues, queued edges only
+  std::string queue;
+};
+
+struct SubgraphStats {
+  // Runs on the shared thread pool rather than a thread of its own
+  bool pooled = false;
+  // Name from the thread config of the subgraph, if any
+  std::string thread;
+};
+
+struct GraphStats {
+  std::chrono::steady_clock::duration uptime{};
+  // Time from Graph::startRunning() until all nodes were initialized
+  std::chrono::steady_clock::duration startup{};
+  // Number of times the rebalancer moved nodes between pipeline stages
+  uint64_t rebalances = 0;
+  // Blocks the queues in front of pipelines dropped while the rebalancer
+  // had them paused
+  uint64_t rebalanceDrops = 0;
+  std::vector<NodeStats> nodes;
+  std::vector<QueueStats> queues;
+  std::vector<EdgeStats> edges;
+  std::vector<SubgraphStats> subgraphs;
+};
+
+// Counters are updated by the thread running the node or queue only, so
+// increments are plain relaxed loads and stores rather than atomic RMWs.
+// Allocations are the exception, shard workers of a node count them too.
+// Any other thread may take a snapshot at any time.
+class NodeCounters final {
+ public:
+  void recordProcess(std::chrono::steady_clock::duration duration);
+  void recordInit(
+      std::chrono::steady_clock::duration start,
+      std::chrono::steady_clock::duration duration);
+  void countIn(size_t samples, size_t bytes);
+  void countOut(size_t samples, size_t bytes);
+  void countAllocation();
+  void countDeferral();
+
+  void snapshot(NodeStats& stats) const;
+  void clear();
+
+ private:
+  static void add(std::atomic<uint64_t>& counter, uint64_t value);
+
+ private:
+  std::atomic<uint64_t> calls_{0};
+  std::atomic<uint64_t> processNanos_{0};
+  std::array<std::atomic<uint64_t>, ProcessTimeBuckets> histogram_{};
+  std::atomic<uint64_t> samplesIn_{0};
+  std::atomic<uint64_t> bytesIn_{0};
+  std::atomic<uint64_t> samplesOut_{0};
+  std::atomic<uint64_t> bytesOut_{0};
+  std::atomic<uint64_t> initStartNanos_{0};
+  std::atomic<uint64_t> initNanos_{0};
+  std::atomic<uint64_t> allocations_{0};
+  std::atomic<uint64_t> deferrals_{0};
+};
+
+class QueueCounters final {
+ public:
+  void sample(size_t size);
+
+  void snapshot(QueueStats& stats) const;
+  void clear();
+
+ private:
+  std::atomic<uint64_t> samples_{0};
+  std::atomic<uint64_t> sizeSum_{0};
+  std::atomic<size_t> maxSize_{0};
+};
+
+inline void NodeCounters::add(std::atomic<uint64_t>& counter, uint64_t value) {
+  counter.store(
+      counter.load(std::memory_order_relaxed) + value,
+      std::memory_order_relaxed);
+}
+
+inline void NodeCounters::countAllocation() {
+  allocations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void NodeCounters::countDeferral() {
+  add(deferrals_, 1);
+}
+
+inline void NodeCounters::countIn(size_t samples, size_t bytes) {
+  add(samplesIn_, samples);
+  add(bytesIn_, bytes);
+}
+
+inline void NodeCounters::countOut(size_t samples, size_t bytes) {
+  add(samplesOut_, samples);
+  add(bytesOut_, bytes);
+}
+
+} // namespace SDR
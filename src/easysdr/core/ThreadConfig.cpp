@@ -0,0 +1,73 @@
+//
+//  ThreadConfig.cpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#include "ThreadConfig.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <cstring>
+#include <iostream>
+
+namespace SDR {
+
+namespace {
+
+void setThreadName(const std::string& name) {
+#ifdef __APPLE__
+  pthread_setname_np(name.c_str());
+#else
+  // Longer names are rejected rather than truncated
+  pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#endif
+}
+
+void setThreadAffinity(const std::vector<unsigned int>& cpus) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const auto cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  const int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (err != 0) {
+    std::cerr << "Cannot set thread affinity: " << std::strerror(err)
+              << std::endl;
+  }
+#else
+  std::cerr << "Thread affinity is not supported on this platform"
+            << std::endl;
+#endif
+}
+
+void setThreadPolicy(ThreadPolicy policy, int priority) {
+  sched_param param{};
+  param.sched_priority = priority;
+  const int err = pthread_setschedparam(
+      pthread_self(),
+      policy == ThreadPolicy::Fifo ? SCHED_FIFO : SCHED_RR,
+      &param);
+  if (err != 0) {
+    std::cerr << "Cannot set real-time thread priority: "
+              << std::strerror(err) << std::endl;
+  }
+}
+
+} // namespace
+
+void applyThreadConfig(const ThreadConfig& config) {
+  if (!config.name.empty()) {
+    setThreadName(config.name);
+  }
+  if (!config.cpus.empty()) {
+    setThreadAffinity(config.cpus);
+  }
+  if (config.policy != ThreadPolicy::Default) {
+    setThreadPolicy(config.policy, config.priority);
+  }
+}
+
+} // namespace SDR
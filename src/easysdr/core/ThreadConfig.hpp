@@ -0,0 +1,37 @@
+//
+//  ThreadConfig.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace SDR {
+
+enum class ThreadPolicy {
+  // Time-shared scheduling, priority is ignored
+  Default,
+  // Real-time SCHED_FIFO and SCHED_RR
+  Fifo,
+  RoundRobin,
+};
+
+struct ThreadConfig {
+  // Shown by top and debuggers, at most 15 characters on Linux
+  std::string name;
+  // CPUs the thread may run on, any CPU if empty. Linux only.
+  std::vector<unsigned int> cpus;
+  ThreadPolicy policy = ThreadPolicy::Default;
+  // Real-time priority, from 1 to 99 on Linux
+  int priority = 0;
+};
+
+// Applies |config| to the calling thread. Failures, typically missing
+// privileges for real-time scheduling, are reported and otherwise ignored.
+void applyThreadConfig(const ThreadConfig& config);
+
+} // namespace SDR
@@ -0,0 +1,163 @@
+//
+//  ThreadPool.cpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <string>
+
+namespace SDR {
+
+namespace {
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+} // namespace
+
+ThreadPool::ThreadPool(
+    size_t threadCount,
+    const ThreadConfig& config /*= ThreadConfig{}*/) {
+  threadCount = std::max<size_t>(threadCount, 1);
+  for (size_t index = 0; index < threadCount; ++index) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (size_t index = 0; index < threadCount; ++index) {
+    auto workerConfig = config;
+    if (!workerConfig.name.empty()) {
+      workerConfig.name += "-" + std::to_string(index);
+    }
+    threads_.emplace_back([this, index, workerConfig]() {
+      workerLoop(index, workerConfig);
+    });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    stopping_ = true;
+  }
+  sleepCondition_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+ThreadPool& ThreadPool::shared() {
+  const auto& config = sharedThreadConfig();
+  static ThreadPool pool(
+      config.cpus.empty() ? std::thread::hardware_concurrency()
+                          : config.cpus.size(),
+      config);
+  return pool;
+}
+
+void ThreadPool::setSharedThreadConfig(const ThreadConfig& config) {
+  sharedThreadConfig() = config;
+}
+
+ThreadConfig& ThreadPool::sharedThreadConfig() {
+  static ThreadConfig config;
+  return config;
+}
+
+void ThreadPool::submit(Task&& task) {
+  const size_t index = currentPool == this
+      ? currentWorker
+      : nextWorker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+  pending_.fetch_add(1);
+  {
+    auto& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.pushBack(std::move(task));
+  }
+  {
+    // Pairs with the predicate check in workerLoop() so the wakeup is not lost
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+  }
+  sleepCondition_.notify_one();
+}
+
+bool ThreadPool::popTask(size_t index, Task& task) {
+  auto& worker = *workers_[index];
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  if (worker.count == 0) {
+    return false;
+  }
+  task = worker.popFront();
+  return true;
+}
+
+bool ThreadPool::stealTask(size_t index, Task& task) {
+  for (size_t offset = 1; offset < workers_.size(); ++offset) {
+    auto& victim = *workers_[(index + offset) % workers_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (victim.count != 0) {
+      task = victim.popBack();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::Worker::pushBack(Task&& task) {
+  if (count == tasks.size()) {
+    std::vector<Task> grown(std::max<size_t>(tasks.size() * 2, 16));
+    for (size_t index = 0; index < count; ++index) {
+      grown[index] = std::move(tasks[(head + index) % tasks.size()]);
+    }
+    tasks.swap(grown);
+    head = 0;
+  }
+  tasks[(head + count) % tasks.size()] = std::move(task);
+  ++count;
+}
+
+ThreadPool::Task ThreadPool::Worker::popFront() {
+  Task task = std::move(tasks[head]);
+  tasks[head] = nullptr;
+  head = (head + 1) % tasks.size();
+  --count;
+  return task;
+}
+
+ThreadPool::Task ThreadPool::Worker::popBack() {
+  --count;
+  auto& slot = tasks[(head + count) % tasks.size()];
+  Task task = std::move(slot);
+  slot = nullptr;
+  return task;
+}
+
+void ThreadPool::workerLoop(size_t index, ThreadConfig config) {
+  currentPool = this;
+  currentWorker = index;
+  applyThreadConfig(config);
+
+  Task task;
+  while (true) {
+    if (popTask(index, task) || stealTask(index, task)) {
+      pending_.fetch_sub(1);
+      try {
+        task();
+      } catch (const std::exception& ex) {
+        std::cerr << "Thread pool task exception: " << ex.what() << std::endl;
+      }
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    sleepCondition_.wait(lock, [this] { return stopping_ || pending_ > 0; });
+    if (stopping_) {
+      break;
+    }
+  }
+}
+
+} // namespace SDR
@@ -0,0 +1,83 @@
+//
+//  ThreadPool.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include "ThreadConfig.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SDR {
+
+// Fixed-size work-stealing thread pool. Every worker owns a task deque; tasks
+// submitted from a worker go to its own deque so that work triggered by a
+// node runs next to the data it produced, tasks submitted from other threads
+// are spread round-robin. Idle workers steal from the other deques before
+// going to sleep.
+class ThreadPool final {
+ public:
+  using Task = std::function<void()>;
+
+  // Workers are named after |config| with their index appended
+  ThreadPool(size_t threadCount, const ThreadConfig& config = ThreadConfig{});
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Process-wide pool with one worker per hardware thread, or per CPU of
+  // its thread config if it has any
+  static ThreadPool& shared();
+
+  // Must be called before the first call to shared()
+  static void setSharedThreadConfig(const ThreadConfig& config);
+
+  void submit(Task&& task);
+
+  size_t threadCount() const;
+
+ private:
+  // Task ring of a worker. Grows when full and never shrinks, so the steady
+  // state submits and pops tasks without allocating.
+  struct Worker {
+    std::mutex mutex;
+    std::vector<Task> tasks;
+    size_t head = 0;
+    size_t count = 0;
+
+    void pushBack(Task&& task);
+    Task popFront();
+    Task popBack();
+  };
+
+  static ThreadConfig& sharedThreadConfig();
+
+  void workerLoop(size_t index, ThreadConfig config);
+  bool popTask(size_t index, Task& task);
+  bool stealTask(size_t index, Task& task);
+
+ private:
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> pending_{0};
+  std::atomic<size_t> nextWorker_{0};
+  std::mutex sleepMutex_;
+  std::condition_variable sleepCondition_;
+  bool stopping_ = false;
+};
+
+inline size_t ThreadPool::threadCount() const {
+  return threads_.size();
+}
+
+} // namespace SDR
@@ -7,21 +7,84 @@
 
 #include "AudioAutoGain.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 namespace SDR {
 
 void AudioAutoGain::init() {
   gain_ = 1.f;
+  newGain_ = 1.f;
+  peak_ = 0.f;
+  peaks_.assign(maxShardCount(), 0.f);
 }
 
 void AudioAutoGain::process() {
   auto& inData = getData<IN_INPUT>();
 
-  float newGain = gain_;
+  const auto inSize = inData.size();
+  const float* in = inData.data();
+
+  // Gain is applied in place when nobody else reads the input
+  auto outData = takeOrAcquireData<IN_INPUT, OUT_OUTPUT>(inSize);
+  outData.resize(inSize);
+
+  beginBlock(inSize);
+
+  // Every shard ramps the gain over its own range and takes its peak
+  float* out = outData.data();
+  const auto peaksEnd = peaks_.begin() + shardCount(inSize);
+  forEachShard(inSize, 0, [this, in, out](const Shard& shard) {
+    peaks_[shard.index] = applyGain(
+        in + shard.begin,
+        out + shard.begin,
+        shard.begin,
+        shard.end - shard.begin);
+  });
+  peak_ = *std::max_element(peaks_.begin(), peaksEnd);
+
+  endBlock();
+
+  setData<OUT_OUTPUT>(std::move(outData));
+}
+
+void AudioAutoGain::beginBlock(size_t size) {
+  blockSize_ = size;
+  peak_ = 0.f;
+}
+
+void AudioAutoGain::processTile(
+    const float* in,
+    float* out,
+    size_t offset,
+    size_t count) {
+  peak_ = std::max(peak_, applyGain(in, out, offset, count));
+}
+
+void AudioAutoGain::endBlock() {
+  gain_ = newGain_;
+  updateGain(peak_ * gain_);
+}
 
+float AudioAutoGain::applyGain(
+    const float* in,
+    float* out,
+    size_t offset,
+    size_t count) const {
+  // Ramps from the gain of the previous block to the new one
   float peak = 0.f;
-  for (float sample : inData) {
-    peak = std::max(peak, std::abs(sample * gain_));
+  for (size_t idx = 0; idx < count; ++idx) {
+    const float a =
+        static_cast<float>(offset + idx) / static_cast<float>(blockSize_);
+    const float g = newGain_ * a + (gain_ * (1.f - a));
+    peak = std::max(peak, std::abs(in[idx]));
+    out[idx] = in[idx] * g;
   }
+  return peak;
+}
+
+void AudioAutoGain::updateGain(float peak) {
+  newGain_ = gain_;
 
   if (peak > 0.f) {
     constexpr float good_zone_min = .1f;
@@ -31,24 +94,11 @@ void AudioAutoGain::process() {
     constexpr float max_dec_rate = .5f;
 
     if (peak < good_zone_min) {
-      newGain = gain_ * std::min(target / peak, max_inc_rate);
+      newGain_ = gain_ * std::min(target / peak, max_inc_rate);
     } else if (peak > good_zone_max) {
-      newGain = gain_ * std::max(target / peak, max_dec_rate);
+      newGain_ = gain_ * std::max(target / peak, max_dec_rate);
     }
   }
-
-  std::vector<float> outData;
-  outData.resize(inData.size());
-
-  for (size_t idx = 0; idx < inData.size(); ++idx) {
-    const float a = static_cast<float>(idx) / static_cast<float>(inData.size());
-    const float g = newGain * a + (gain_ * (1.f - a));
-    outData[idx] = inData[idx] * g;
-  }
-
-  gain_ = newGain;
-
-  setData<OUT_OUTPUT>(std::move(outData));
 }
 
 } // namespace SDR
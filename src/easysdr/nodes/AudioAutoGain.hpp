@@ -23,8 +23,38 @@ class AudioAutoGain final
   virtual void init() override;
   virtual void process() override;
 
+  virtual bool isShardable() const override {
+    return true;
+  }
+
+  // Fused stage, see FusedTraits. The gain a block ramps to is picked from
+  // the peak of the previous block, so the stage does not scan its block.
+  using TileInput = float;
+  using TileOutput = float;
+  constexpr static bool Fusable = true;
+  constexpr static bool ScansBlock = false;
+
+  void beginBlock(size_t size);
+  void scanBlock(const float* in, size_t size) {}
+  void processTile(const float* in, float* out, size_t offset, size_t count);
+  void endBlock();
+
+ private:
+  // Applies the gain ramp to the samples [offset, offset + count) of the
+  // block, returns their peak before the gain
+  float applyGain(const float* in, float* out, size_t offset, size_t count)
+      const;
+  // Picks the gain the next block ramps to from the peak of this one
+  void updateGain(float peak);
+
  private:
   float gain_ = 1.f;
+  float newGain_ = 1.f;
+  size_t blockSize_ = 0;
+  // Peak of the block so far before the gain
+  float peak_ = 0.f;
+  // Peak of every shard of the block, sized in init()
+  std::vector<float> peaks_;
 };
 
 } // namespace SDR
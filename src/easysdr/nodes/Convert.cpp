@@ -7,6 +7,7 @@
 
 #include "Convert.hpp"
 
+#include <algorithm>
 #include <complex>
 
 namespace SDR {
@@ -83,32 +84,47 @@ static_assert(convert<float, int16_t>(.5f) == 16383);
 static_assert(convert<float, int16_t>(1.f) == 32767);
 
 template <typename T1, typename T2>
-void convert_vector(const std::vector<T1>& inData, std::vector<T2>& outData) {
-  outData.reserve(inData.size());
-  for (auto sample : inData) {
-    outData.push_back(convert<T1, T2>(sample));
+size_t converted_size(const std::vector<T1>& inData) {
+  if constexpr (std::is_same<T2, std::complex<float>>::value) {
+    return inData.size() >> 1;
+  } else if constexpr (std::is_same<T1, std::complex<float>>::value) {
+    return inData.size() << 1;
+  } else {
+    return inData.size();
+  }
+}
+
+// Converts samples [begin, end) of the input, or pairs of samples when
+// converting to complex
+template <typename T1, typename T2>
+void convert_range(const T1* inData, T2* outData, size_t begin, size_t end) {
+  for (size_t idx = begin; idx < end; ++idx) {
+    outData[idx] = convert<T1, T2>(inData[idx]);
   }
 }
 
 template <typename T1>
-void convert_vector(
-    const std::vector<T1>& inData,
-    std::vector<std::complex<float>>& outData) {
-  outData.reserve(inData.size() >> 1);
-  for (auto it = inData.begin(); it != inData.end(); it += 2) {
-    outData.emplace_back(
-        convert<T1, float>(*it), convert<T1, float>(*(it + 1)));
+void convert_range(
+    const T1* inData,
+    std::complex<float>* outData,
+    size_t begin,
+    size_t end) {
+  for (size_t idx = begin; idx < end; ++idx) {
+    outData[idx] = std::complex<float>(
+        convert<T1, float>(inData[idx << 1]),
+        convert<T1, float>(inData[(idx << 1) + 1]));
   }
 }
 
 template <typename T2>
-void convert_vector(
-    const std::vector<std::complex<float>>& inData,
-    std::vector<T2>& outData) {
-  outData.reserve(inData.size() << 1);
-  for (const auto& sample : inData) {
-    outData.push_back(convert<float, T2>(sample.real()));
-    outData.push_back(convert<float, T2>(sample.imag()));
+void convert_range(
+    const std::complex<float>* inData,
+    T2* outData,
+    size_t begin,
+    size_t end) {
+  for (size_t idx = begin; idx < end; ++idx) {
+    outData[idx << 1] = convert<float, T2>(inData[idx].real());
+    outData[(idx << 1) + 1] = convert<float, T2>(inData[idx].imag());
   }
 }
 
@@ -118,12 +134,31 @@ template <typename T1, typename T2>
 void Convert<T1, T2>::process() {
   auto& inData = this->template getData<IN_INPUT>();
 
-  std::vector<T2> outData;
-  convert_vector(inData, outData);
+  const size_t outSize = converted_size<T1, T2>(inData);
+  auto outData = this->template acquireData<OUT_OUTPUT>(outSize);
+  outData.resize(outSize);
+
+  // Every shard converts its own range of samples, or of pairs of samples
+  // on the complex side
+  const size_t size = std::min(inData.size(), outSize);
+  const T1* in = inData.data();
+  T2* out = outData.data();
+  this->forEachShard(size, 0, [in, out](const Shard& shard) {
+    convert_range(in, out, shard.begin, shard.end);
+  });
 
   this->template setData<OUT_OUTPUT>(std::move(outData));
 }
 
+template <typename T1, typename T2>
+void Convert<T1, T2>::processTile(
+    const T1* in,
+    T2* out,
+    size_t /*offset*/,
+    size_t count) {
+  convert_range(in, out, 0, count);
+}
+
 template class Convert<uint8_t, int16_t>;
 template class Convert<uint8_t, float>;
 template class Convert<uint8_t, std::complex<float>>;
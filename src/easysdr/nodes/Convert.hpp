@@ -9,6 +9,8 @@
 
 #include "easysdr/core/Node.hpp"
 
+#include <complex>
+#include <type_traits>
 #include <vector>
 
 namespace SDR {
@@ -22,6 +24,24 @@ class Convert final
   enum { IN_INPUT = 0, OUT_OUTPUT };
 
   virtual void process() override;
+
+  virtual bool isShardable() const override {
+    return true;
+  }
+
+  // Fused stage, see FusedTraits. Conversions to and from complex samples
+  // change the number of samples and cannot be fused.
+  using TileInput = T1;
+  using TileOutput = T2;
+  constexpr static bool Fusable =
+      !std::is_same<T1, std::complex<float>>::value &&
+      !std::is_same<T2, std::complex<float>>::value;
+  constexpr static bool ScansBlock = false;
+
+  void beginBlock(size_t size) {}
+  void scanBlock(const T1* in, size_t size) {}
+  void processTile(const T1* in, T2* out, size_t offset, size_t count);
+  void endBlock() {}
 };
 
 } // namespace SDR
@@ -40,26 +40,26 @@ void DecodeNRSC5<T>::callback(const nrsc5_event_t* evt) {
       ++ber_count_;
       ber_min_ = std::min(ber_min_, ber);
       ber_max_ = std::max(ber_max_, ber);
-      setMetadata("nrsc5.ber", ber);
-      setMetadata("nrsc5.ber_avg", ber_sum_ / ber_count_);
-      setMetadata("nrsc5.ber_min", ber_min_);
-      setMetadata("nrsc5.ber_max", ber_max_);
+      setMetadata(MetadataKeys::NRSC5BER, ber);
+      setMetadata(MetadataKeys::NRSC5BERAverage, ber_sum_ / ber_count_);
+      setMetadata(MetadataKeys::NRSC5BERMin, ber_min_);
+      setMetadata(MetadataKeys::NRSC5BERMax, ber_max_);
       break;
     }
 
     case NRSC5_EVENT_MER:
-      setMetadata("nrsc5.mer_lower", evt->mer.lower);
-      setMetadata("nrsc5.mer_upper", evt->mer.upper);
+      setMetadata(MetadataKeys::NRSC5MERLower, evt->mer.lower);
+      setMetadata(MetadataKeys::NRSC5MERUpper, evt->mer.upper);
       break;
 
     case NRSC5_EVENT_ID3:
       if (evt->id3.program == program()) {
-        setMetadata("id3.title", evt->id3.title);
-        setMetadata("id3.artist", evt->id3.artist);
-        setMetadata("id3.album", evt->id3.album);
-        setMetadata("id3.genre", evt->id3.genre);
-        setMetadata("id3.ufid_owner", evt->id3.ufid.owner);
-        setMetadata("id3.ufid_id", evt->id3.ufid.id);
+        setMetadata(MetadataKeys::ID3Title, evt->id3.title);
+        setMetadata(MetadataKeys::ID3Artist, evt->id3.artist);
+        setMetadata(MetadataKeys::ID3Album, evt->id3.album);
+        setMetadata(MetadataKeys::ID3Genre, evt->id3.genre);
+        setMetadata(MetadataKeys::ID3UFIDOwner, evt->id3.ufid.owner);
+        setMetadata(MetadataKeys::ID3UFIDId, evt->id3.ufid.id);
         // TODO process XHDR frames
       }
       break;
@@ -82,7 +82,7 @@ void DecodeNRSC5<T>::callback(const nrsc5_event_t* evt) {
 }
 
 template <typename T>
-void DecodeNRSC5<T>::setMetadata(const char* key, const char* value) {
+void DecodeNRSC5<T>::setMetadata(MetadataKey key, const char* value) {
   if (!value) {
     return;
   }
@@ -95,7 +95,7 @@ void DecodeNRSC5<T>::setMetadata(const char* key, const char* value) {
 
 template <typename T>
 template <typename T0>
-void DecodeNRSC5<T>::setMetadata(const char* key, T0 value) {
+void DecodeNRSC5<T>::setMetadata(MetadataKey key, T0 value) {
   metadata_[key] = value;
 }
 
@@ -137,12 +137,17 @@ void DecodeNRSC5<T>::process() {
   pipeIQData();
 
   if (!audioBuffer_.empty()) {
-    this->template setData<OUT_OUTPUT>(std::move(audioBuffer_));
+    // Keep accumulating audio into a recycled block of the same size
+    auto outData =
+        this->template acquireData<OUT_OUTPUT>(audioBuffer_.size());
+    std::swap(outData, audioBuffer_);
+    this->template setData<OUT_OUTPUT>(std::move(outData));
     this->template setData<OUT_DISCONTINUITY>(std::move(discontinuity_));
     discontinuity_ = false;
   }
 
-  if (!metadata_.empty()) {
+  // Held back while nobody reads it, one entry per key at most
+  if (!metadata_.empty() && this->template isDemanded<OUT_METADATA>()) {
     this->template setData<OUT_METADATA>(std::move(metadata_));
     metadata_.clear();
   }
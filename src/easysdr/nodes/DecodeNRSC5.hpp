@@ -52,10 +52,10 @@ class DecodeNRSC5 final : public Node<
   void pipeIQData();
   void observeControls();
   void unobserveControls();
-  void setMetadata(const char* key, const char* value);
+  void setMetadata(MetadataKey key, const char* value);
 
   template <typename T0>
-  void setMetadata(const char* key, T0 value);
+  void setMetadata(MetadataKey key, T0 value);
 
  private:
   nrsc5_t* decoder_ = nullptr;
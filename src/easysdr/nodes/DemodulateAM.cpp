@@ -17,25 +17,49 @@ void DemodulateAM::init() {
 void DemodulateAM::process() {
   auto& inData = getData<IN_INPUT>();
 
-  std::vector<float> outData;
+  auto outData = acquireData<OUT_OUTPUT>(inData.size());
   outData.resize(inData.size());
 
   if (dc_blocker_) {
+    // The magnitudes are computed by shards, the filter carries its state
+    // over from the previous block and runs in order
+    forEachShard(inData.size(), 0, [&inData, &outData](const Shard& shard) {
+      for (size_t idx = shard.begin; idx < shard.end; idx++) {
+        const float i = inData[idx].real();
+        const float q = inData[idx].imag();
+        outData[idx] = sqrt(i * i + q * q);
+      }
+    });
     for (size_t idx = 0; idx < inData.size(); idx++) {
-      const float i = inData[idx].real();
-      const float q = inData[idx].imag();
-      firfilt_rrrf_push(dc_blocker_, sqrt(i * i + q * q));
+      firfilt_rrrf_push(dc_blocker_, outData[idx]);
       firfilt_rrrf_execute(dc_blocker_, &outData[idx]);
     }
   } else {
-    for (size_t idx = 0; idx < inData.size(); idx++) {
-      ampmodem_demodulate(demodulator_, inData[idx], &outData[idx]);
-    }
+    processTile(inData.data(), outData.data(), 0, inData.size());
   }
 
   setData<OUT_OUTPUT>(std::move(outData));
 }
 
+void DemodulateAM::processTile(
+    const std::complex<float>* in,
+    float* out,
+    size_t /*offset*/,
+    size_t count) {
+  if (dc_blocker_) {
+    for (size_t idx = 0; idx < count; idx++) {
+      const float i = in[idx].real();
+      const float q = in[idx].imag();
+      firfilt_rrrf_push(dc_blocker_, sqrt(i * i + q * q));
+      firfilt_rrrf_execute(dc_blocker_, &out[idx]);
+    }
+  } else {
+    for (size_t idx = 0; idx < count; idx++) {
+      ampmodem_demodulate(demodulator_, in[idx], &out[idx]);
+    }
+  }
+}
+
 void DemodulateAM::destroy() {
   unobserveControls();
   destroyDemodulator();
@@ -30,6 +30,25 @@ class DemodulateAM final : public Node<
   virtual void process() override;
   virtual void destroy() override;
 
+  virtual bool isShardable() const override {
+    return true;
+  }
+
+  // Fused stage, see FusedTraits
+  using TileInput = std::complex<float>;
+  using TileOutput = float;
+  constexpr static bool Fusable = true;
+  constexpr static bool ScansBlock = false;
+
+  void beginBlock(size_t size) {}
+  void scanBlock(const std::complex<float>* in, size_t size) {}
+  void processTile(
+      const std::complex<float>* in,
+      float* out,
+      size_t offset,
+      size_t count);
+  void endBlock() {}
+
   enum { MODE_AM = 0, MODE_LSB, MODE_USB, MODE_DSB };
 
   unsigned int mode() const;
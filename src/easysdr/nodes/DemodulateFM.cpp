@@ -16,7 +16,7 @@ void DemodulateFM::init() {
 void DemodulateFM::process() {
   auto& inData = getData<IN_INPUT>();
 
-  std::vector<float> outData;
+  auto outData = acquireData<OUT_OUTPUT>(inData.size());
   outData.resize(inData.size());
 
   freqdem_demodulate_block(
@@ -45,8 +45,7 @@ void DemodulateFMS::init() {
 void DemodulateFMS::process() {
   auto& inData = getData<IN_INPUT>();
 
-  std::vector<float> outData;
-  outData.reserve(inData.size());
+  auto outData = acquireData<OUT_OUTPUT>(inData.size());
 
   float phase_error = 0;
   for (float inSample : inData) {
@@ -20,26 +20,30 @@ void FrequencyShift::process() {
   auto& inData = getData<IN_INPUT>();
   const auto inSize = inData.size();
 
+  const auto in = inData.data();
+
   if (!shifter_) {
-    setData<OUT_OUTPUT>(std::move(inData));
+    // Pass through, copying only if the input is shared with other nodes
+    if (isExclusive<IN_INPUT>()) {
+      setData<OUT_OUTPUT>(takeData<IN_INPUT>());
+    } else {
+      auto outData = acquireData<OUT_OUTPUT>(inSize);
+      outData.assign(inData.begin(), inData.end());
+      setData<OUT_OUTPUT>(std::move(outData));
+    }
     return;
   }
 
-  std::vector<std::complex<float>> outData;
+  // The NCO mixes sample by sample, so it can run in place
+  auto outData = takeOrAcquireData<IN_INPUT, OUT_OUTPUT>(inSize);
   outData.resize(inSize);
 
   if (targetFreq() < sourceFreq()) {
     nco_crcf_mix_block_up(
-        shifter_,
-        inData.data(),
-        outData.data(),
-        static_cast<unsigned int>(inSize));
+        shifter_, in, outData.data(), static_cast<unsigned int>(inSize));
   } else {
     nco_crcf_mix_block_down(
-        shifter_,
-        inData.data(),
-        outData.data(),
-        static_cast<unsigned int>(inSize));
+        shifter_, in, outData.data(), static_cast<unsigned int>(inSize));
   }
   setData<OUT_OUTPUT>(std::move(outData));
 }
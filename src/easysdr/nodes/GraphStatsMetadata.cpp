@@ -0,0 +1,153 @@
+//
+//  GraphStatsMetadata.cpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#include "GraphStatsMetadata.hpp"
+
+#include <sstream>
+
+namespace SDR {
+
+namespace {
+
+MetadataKey internKey(const std::string& prefix, const char* name) {
+  return MetadataKey::intern(prefix + name);
+}
+
+} // namespace
+
+GraphStatsMetadata::NodeKeys::NodeKeys(const std::string& prefix)
+    : calls(internKey(prefix, "calls")),
+      cpuPercent(internKey(prefix, "cpu_percent")),
+      processMicros(internKey(prefix, "process_us")),
+      processHistogram(internKey(prefix, "process_us_log2_histogram")),
+      samplesInPerSec(internKey(prefix, "samples_in_per_sec")),
+      samplesOutPerSec(internKey(prefix, "samples_out_per_sec")),
+      bytesInPerSec(internKey(prefix, "bytes_in_per_sec")),
+      bytesOutPerSec(internKey(prefix, "bytes_out_per_sec")),
+      initStartMillis(internKey(prefix, "init_start_ms")),
+      initMillis(internKey(prefix, "init_ms")),
+      allocations(internKey(prefix, "allocations")),
+      deferrals(internKey(prefix, "deferrals")) {}
+
+GraphStatsMetadata::QueueKeys::QueueKeys(const std::string& prefix)
+    : size(internKey(prefix, "size")),
+      capacity(internKey(prefix, "capacity")),
+      maxSize(internKey(prefix, "max_size")),
+      averageSize(internKey(prefix, "average_size")),
+      highWaterMark(internKey(prefix, "high_water_mark")),
+      drops(internKey(prefix, "drops")),
+      underruns(internKey(prefix, "underruns")) {}
+
+void GraphStatsMetadata::init() {
+  lastPublished_ = std::chrono::steady_clock::now();
+  lastUptime_ = {};
+  nodes_.clear();
+}
+
+void GraphStatsMetadata::process() {
+  const bool hasInput = hasData<IN_INPUT>() && !getData<IN_INPUT>().empty();
+  const auto now = std::chrono::steady_clock::now();
+  const bool publish = now - lastPublished_ >= interval_;
+  if (!hasInput && !publish) {
+    return;
+  }
+
+  MetadataPacket metadata;
+  if (hasInput) {
+    metadata = isExclusive<IN_INPUT>() ? takeData<IN_INPUT>()
+                                       : getData<IN_INPUT>();
+  }
+  if (publish) {
+    addStats(metadata);
+    lastPublished_ = now;
+  }
+  setData<OUT_OUTPUT>(std::move(metadata));
+}
+
+void GraphStatsMetadata::addStats(MetadataPacket& metadata) {
+  using namespace std::chrono;
+
+  static const auto startupKey = MetadataKey::intern("graph.startup_ms");
+  static const auto rebalancesKey = MetadataKey::intern("graph.rebalances");
+  static const auto rebalanceDropsKey =
+      MetadataKey::intern("graph.rebalance_drops");
+
+  const auto stats = graph_.stats();
+
+  // Rates and CPU shares are computed over the last interval
+  const double elapsedSeconds =
+      duration_cast<duration<double>>(stats.uptime - lastUptime_).count();
+  const auto perSecond = [elapsedSeconds](uint64_t delta) {
+    return elapsedSeconds > 0. ? static_cast<double>(delta) / elapsedSeconds
+                               : 0.;
+  };
+
+  for (const auto& node : stats.nodes) {
+    auto found = nodes_.find(node.name);
+    if (found == nodes_.end()) {
+      const NodeKeys keys("graph.nodes." + node.name + ".");
+      found = nodes_.emplace(node.name, NodeState{keys, {}}).first;
+    }
+    const auto& keys = found->second.keys;
+    auto& last = found->second.last;
+    const auto calls = node.calls - last.calls;
+    const auto processNanos = node.processNanos - last.processNanos;
+
+    std::ostringstream histogram;
+    for (size_t bucket = 0; bucket < node.processTimeHistogram.size();
+         ++bucket) {
+      histogram << (bucket ? "," : "") << node.processTimeHistogram[bucket];
+    }
+
+    metadata[keys.calls] = static_cast<unsigned int>(node.calls);
+    metadata[keys.cpuPercent] = perSecond(processNanos) / 1e7;
+    metadata[keys.processMicros] = calls
+        ? static_cast<double>(processNanos) / static_cast<double>(calls) / 1e3
+        : 0.;
+    metadata[keys.processHistogram] = histogram.str();
+    metadata[keys.samplesInPerSec] =
+        perSecond(node.samplesIn - last.samplesIn);
+    metadata[keys.samplesOutPerSec] =
+        perSecond(node.samplesOut - last.samplesOut);
+    metadata[keys.bytesInPerSec] = perSecond(node.bytesIn - last.bytesIn);
+    metadata[keys.bytesOutPerSec] = perSecond(node.bytesOut - last.bytesOut);
+    metadata[keys.initStartMillis] =
+        static_cast<double>(node.initStartNanos) / 1e6;
+    metadata[keys.initMillis] = static_cast<double>(node.initNanos) / 1e6;
+    metadata[keys.allocations] = static_cast<unsigned int>(node.allocations);
+    metadata[keys.deferrals] = static_cast<unsigned int>(node.deferrals);
+
+    last = node;
+  }
+
+  for (const auto& queue : stats.queues) {
+    auto found = queues_.find(queue.name);
+    if (found == queues_.end()) {
+      const QueueKeys keys("graph.queues." + queue.name + ".");
+      found = queues_.emplace(queue.name, keys).first;
+    }
+    const auto& keys = found->second;
+    metadata[keys.size] = static_cast<unsigned int>(queue.size);
+    metadata[keys.capacity] = static_cast<unsigned int>(queue.capacity);
+    metadata[keys.maxSize] = static_cast<unsigned int>(queue.maxSize);
+    metadata[keys.averageSize] = queue.averageSize;
+    metadata[keys.highWaterMark] =
+        static_cast<unsigned int>(queue.highWaterMark);
+    metadata[keys.drops] = static_cast<unsigned int>(queue.drops);
+    metadata[keys.underruns] = static_cast<unsigned int>(queue.underruns);
+  }
+
+  metadata[startupKey] =
+      duration_cast<duration<double, std::milli>>(stats.startup).count();
+  metadata[rebalancesKey] = static_cast<unsigned int>(stats.rebalances);
+  metadata[rebalanceDropsKey] =
+      static_cast<unsigned int>(stats.rebalanceDrops);
+
+  lastUptime_ = stats.uptime;
+}
+
+} // namespace SDR
@@ -0,0 +1,86 @@
+//
+//  GraphStatsMetadata.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include "easysdr/core/Graph.hpp"
+#include "easysdr/core/Metadata.hpp"
+#include "easysdr/core/Node.hpp"
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+namespace SDR {
+
+// Passes metadata packets through and periodically adds the graph's per-node
+// and per-queue stats to them under the "graph." prefix. Empty packets are
+// only taken as a chance to publish, see SDRPlayInput::MetadataInterval.
+class GraphStatsMetadata final
+    : public Node<OptionalInput<MetadataPacket>, Output<MetadataPacket>> {
+ public:
+  GraphStatsMetadata(
+      const Graph& graph,
+      std::chrono::milliseconds interval = std::chrono::seconds(1))
+      : graph_(graph), interval_(interval) {}
+
+  enum { IN_INPUT = 0, OUT_OUTPUT };
+
+  virtual void init() override;
+  virtual void process() override;
+
+ private:
+  void addStats(MetadataPacket& metadata);
+
+ private:
+  // Keys are interned the first time a node or queue shows up in the stats,
+  // interning takes a lock
+  struct NodeKeys {
+    explicit NodeKeys(const std::string& prefix);
+
+    MetadataKey calls;
+    MetadataKey cpuPercent;
+    MetadataKey processMicros;
+    MetadataKey processHistogram;
+    MetadataKey samplesInPerSec;
+    MetadataKey samplesOutPerSec;
+    MetadataKey bytesInPerSec;
+    MetadataKey bytesOutPerSec;
+    MetadataKey initStartMillis;
+    MetadataKey initMillis;
+    MetadataKey allocations;
+    MetadataKey deferrals;
+  };
+
+  struct QueueKeys {
+    explicit QueueKeys(const std::string& prefix);
+
+    MetadataKey size;
+    MetadataKey capacity;
+    MetadataKey maxSize;
+    MetadataKey averageSize;
+    MetadataKey highWaterMark;
+    MetadataKey drops;
+    MetadataKey underruns;
+  };
+
+  struct NodeState {
+    NodeKeys keys;
+    // Stats as of the last publication
+    NodeStats last;
+  };
+
+ private:
+  const Graph& graph_;
+  std::chrono::milliseconds interval_;
+  std::chrono::steady_clock::time_point lastPublished_;
+  std::chrono::steady_clock::duration lastUptime_{};
+  std::unordered_map<std::string, NodeState> nodes_;
+  std::unordered_map<std::string, QueueKeys> queues_;
+};
+
+} // namespace SDR
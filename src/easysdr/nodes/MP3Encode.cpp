@@ -27,11 +27,6 @@ void MP3Encode::process() {
   bool discontinuity = isConnected<IN_DISCONTINUITY>() &&
       hasData<IN_DISCONTINUITY>() && getData<IN_DISCONTINUITY>();
 
-  if (!hasData<IN_INPUT>()) {
-    assert(!discontinuity);
-    return;
-  }
-
   auto& inData = getData<IN_INPUT>();
   if (inData.empty()) {
     return;
@@ -91,8 +86,7 @@ void MP3Encode::process() {
   auto ptr = buffer_.begin();
   const auto ptrEnd = buffer_.begin() + bytesEncoded;
 
-  std::vector<MP3Packet> packets;
-  packets.reserve(4);
+  auto packets = acquireData<OUT_OUTPUT>(4);
 
   while (ptr != ptrEnd) {
     const size_t bytesToCopy = std::min(
@@ -130,6 +124,8 @@ void MP3Encode::process() {
 
   if (!packets.empty()) {
     setData<OUT_OUTPUT>(std::move(packets));
+  } else {
+    recycleData<OUT_OUTPUT>(std::move(packets));
   }
 }
 
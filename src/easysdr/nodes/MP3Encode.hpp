@@ -26,7 +26,7 @@ struct MP3Packet {
 
 class MP3Encode final : public Node<
                             Input<std::vector<int16_t>>,
-                            Input<bool>,
+                            OptionalInput<bool>,
                             Output<std::vector<MP3Packet>>> {
  public:
   MP3Encode(
@@ -47,6 +47,12 @@ class MP3Encode final : public Node<
     return bitrateKbps_;
   }
 
+  // Samples per channel in an MP3 frame. Inputs made of whole frames, see
+  // Rechunk, keep LAME from buffering partial frames between calls.
+  constexpr static size_t samplesInPacket() {
+    return 1152;
+  }
+
  protected:
   unsigned int sampleRate() const {
     return sampleRate_;
@@ -61,10 +67,6 @@ class MP3Encode final : public Node<
     return bitrateKbps() * 144000 / sampleRate();
   }
 
-  constexpr static size_t samplesInPacket() {
-    return 1152;
-  }
-
  private:
   const unsigned int sampleRate_;
   const unsigned int numChannels_;
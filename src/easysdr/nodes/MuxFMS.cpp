@@ -60,8 +60,7 @@ void MuxFMS::process() {
   auto& inMono = getData<IN_MONO>();
   auto& inStereo = getData<IN_STEREO>();
 
-  std::vector<float> outData;
-  outData.reserve(inMono.size() * 2);
+  auto outData = acquireData<OUT_OUTPUT>(inMono.size() * 2);
 
   for (size_t idx = 0; idx < inMono.size() && idx < inStereo.size(); ++idx) {
     float l, r;
@@ -0,0 +1,74 @@
+//
+//  Rechunk.cpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#include "Rechunk.hpp"
+
+#include <complex>
+
+namespace SDR {
+
+template <typename T>
+Rechunk<T>::Rechunk(size_t chunkSize) : chunkSize_(chunkSize) {
+  if (chunkSize == 0) {
+    throw std::runtime_error("invalid chunk size");
+  }
+}
+
+template <typename T>
+void Rechunk<T>::init() {
+  pending_.clear();
+  pending_.reserve(chunkSize_);
+  discontinuity_ = false;
+}
+
+template <typename T>
+void Rechunk<T>::process() {
+  if (this->template isConnected<IN_DISCONTINUITY>() &&
+      this->template hasData<IN_DISCONTINUITY>() &&
+      this->template getData<IN_DISCONTINUITY>()) {
+    discontinuity_ = true;
+  }
+
+  auto& inData = this->template getData<IN_INPUT>();
+
+  const size_t available = pending_.size() + inData.size();
+  const size_t outSize = available - available % chunkSize_;
+  if (outSize == 0) {
+    pending_.insert(pending_.end(), inData.begin(), inData.end());
+    return;
+  }
+
+  // Input blocks which already are whole chunks pass through
+  if (pending_.empty() && outSize == inData.size() &&
+      this->template isExclusive<IN_INPUT>()) {
+    emit(this->template takeData<IN_INPUT>());
+    return;
+  }
+
+  auto outData = this->template acquireData<OUT_OUTPUT>(outSize);
+  outData.insert(outData.end(), pending_.begin(), pending_.end());
+  const auto split = inData.begin() + (outSize - pending_.size());
+  outData.insert(outData.end(), inData.begin(), split);
+  pending_.assign(split, inData.end());
+
+  emit(std::move(outData));
+}
+
+template <typename T>
+void Rechunk<T>::emit(std::vector<T>&& outData) {
+  this->template setData<OUT_OUTPUT>(std::move(outData));
+  if (discontinuity_) {
+    this->template setData<OUT_DISCONTINUITY>(std::move(discontinuity_));
+    discontinuity_ = false;
+  }
+}
+
+template class Rechunk<int16_t>;
+template class Rechunk<float>;
+template class Rechunk<std::complex<float>>;
+
+} // namespace SDR
@@ -0,0 +1,49 @@
+//
+//  Rechunk.hpp
+//  Turnip
+//
+//  Created by Andrei Chtcherbatchenko on 10/18/26.
+//
+
+#pragma once
+
+#include "easysdr/core/Node.hpp"
+
+#include <vector>
+
+namespace SDR {
+
+// Emits blocks whose size is a multiple of a fixed chunk size, keeping the
+// samples which do not make a whole chunk for the next block. Nodes fed by it
+// can assume fixed-length input, e.g. whole MP3 frames or a multiple of the
+// SIMD width. A discontinuity flagged on an input block is passed on with
+// the next output block, the first one holding samples from after the gap.
+template <typename T>
+class Rechunk final : public Node<
+                          Input<std::vector<T>>,
+                          OptionalInput<bool>,
+                          Output<std::vector<T>>,
+                          Output<bool>> {
+ public:
+  Rechunk(size_t chunkSize);
+
+  enum { IN_INPUT = 0, IN_DISCONTINUITY, OUT_OUTPUT, OUT_DISCONTINUITY };
+
+  virtual void init() override;
+  virtual void process() override;
+
+  size_t chunkSize() const {
+    return chunkSize_;
+  }
+
+ private:
+  void emit(std::vector<T>&& outData);
+
+ private:
+  const size_t chunkSize_;
+  std::vector<T> pending_;
+  // Latched while the samples after the gap are buffered
+  bool discontinuity_ = false;
+};
+
+} // namespace SDR
@@ -20,8 +20,9 @@ void Resample<T>::process() {
   auto& inData = this->template getData<IN_INPUT>();
   const auto inSize = inData.size();
 
-  std::vector<T> outData;
-  outData.resize(msresamp_->estimate(inSize));
+  const auto estimatedSize = msresamp_->estimate(inSize);
+  auto outData = this->template acquireData<OUT_OUTPUT>(estimatedSize);
+  outData.resize(estimatedSize);
 
   const auto outSize =
       msresamp_->execute(inSize, inData.data(), outData.data());
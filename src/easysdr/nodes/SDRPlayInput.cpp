@@ -19,9 +19,11 @@ void SDRPlayInput<T>::init() {
   if (frequency() < device()->min_center_freq()) {
     throw std::runtime_error("frequency too low for device");
   }
-  stream_ = device()->template open_stream<T>();
   device()->add_observer(this);
   device()->start(sampleRate_, frequency(), autoGain_);
+  // Opened once tuned, a device kept running by the previous tuner would
+  // otherwise fill it with samples of the old frequency
+  stream_ = device()->template open_stream<T>();
   observeControls();
 }
 
@@ -29,35 +31,44 @@ template <typename T>
 void SDRPlayInput<T>::process() {
   const auto sample_buffer = stream_->read_next_buffer();
 
-  std::vector<T> out;
+  auto out = this->template acquireData<OUT_OUTPUT>(
+      sample_buffer->samples.size());
   out.assign(sample_buffer->samples.begin(), sample_buffer->samples.end());
   this->template setData<OUT_OUTPUT>(std::move(out));
 
+  // Held back while nobody reads it, one entry per key at most
+  if (!this->template isDemanded<OUT_METADATA>()) {
+    return;
+  }
+  const auto now = std::chrono::steady_clock::now();
   std::lock_guard<std::mutex> lock(metadata_mutex_);
-  if (!metadata_.empty()) {
+  if (!metadata_.empty() || now - metadataSent_ >= MetadataInterval) {
     this->template setData<OUT_METADATA>(std::move(metadata_));
     metadata_.clear();
+    metadataSent_ = now;
   }
 }
 
 template <typename T>
 void SDRPlayInput<T>::destroy() {
   unobserveControls();
-  device()->stop();
   device()->remove_observer(this);
   stream_ = nullptr;
+  // The next tuner may pick up the running device
+  device()->stop_when_idle();
 }
 
 template <typename T>
 void SDRPlayInput<T>::device_params_changed(
     const sdrplay::device_params& params) {
   std::lock_guard<std::mutex> lock(metadata_mutex_);
-  metadata_["sdrplay.gain"] = params.gain;
-  metadata_["sdrplay.rf_gr"] = params.rf_gr;
-  metadata_["sdrplay.if_gr"] = params.if_gr;
-  metadata_["sdrplay.freq"] = params.freq;
-  metadata_["sdrplay.lna_state"] = params.lna_state;
-  metadata_["sdrplay.num_lna_states"] = device()->num_lna_states(params.freq);
+  metadata_[MetadataKeys::SDRPlayGain] = params.gain;
+  metadata_[MetadataKeys::SDRPlayRFGainReduction] = params.rf_gr;
+  metadata_[MetadataKeys::SDRPlayIFGainReduction] = params.if_gr;
+  metadata_[MetadataKeys::SDRPlayFreq] = params.freq;
+  metadata_[MetadataKeys::SDRPlayLNAState] = params.lna_state;
+  metadata_[MetadataKeys::SDRPlayNumLNAStates] =
+      device()->num_lna_states(params.freq);
 }
 
 template <typename T>
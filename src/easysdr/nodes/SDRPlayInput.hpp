@@ -37,10 +37,19 @@ class SDRPlayInput final : public Node<
 
   enum { OUT_OUTPUT = 0, OUT_METADATA, CTRL_FREQ, CTRL_LNA_STATE };
 
+  // Metadata goes out at least this often, empty if nothing changed, so that
+  // nodes reading it through a queue, such as GraphStatsMetadata, get to run
+  constexpr static std::chrono::milliseconds MetadataInterval{100};
+
   virtual void init() override;
   virtual void process() override;
   virtual void destroy() override;
 
+  // Starts streaming from the device
+  virtual bool initLast() const override {
+    return true;
+  }
+
   double frequency() const;
   void setFrequency(double frequency);
 
@@ -63,6 +72,7 @@ class SDRPlayInput final : public Node<
   bool autoGain_;
   std::mutex metadata_mutex_;
   MetadataPacket metadata_;
+  std::chrono::steady_clock::time_point metadataSent_;
 };
 
 template <typename T>
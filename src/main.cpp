@@ -6,15 +6,20 @@
 //
 
 #include "server/Server.hpp"
+#include "tuners/BaseTuner.hpp"
 
+#include <easysdr/core/ThreadPool.hpp>
 #include <sdrplay/api.hpp>
 #include <sdrplay/device.hpp>
 
 #include <signal.h>
 #include <iostream>
+#include <string>
 
 namespace {
 
+constexpr std::chrono::seconds DeviceKeepAlive{10};
+
 bool stopping = false;
 std::mutex signal_mutex;
 std::condition_variable signal_condition;
@@ -25,11 +30,74 @@ void signal_handler(int s) {
   signal_condition.notify_one();
 }
 
+// Runs the threads reading from the device at real-time priority on a CPU of
+// their own, so that load from the encoders, the metadata paths and the
+// RTSP server does not make the device drop samples. Tuners only leave the
+// device input and the queues it feeds on those threads, everything else,
+// stats and metadata included, runs on the other CPUs, on the pool with
+// --thread-pool.
+void configureThreads(Tuner::Server& server) {
+  SDR::ThreadConfig deviceConfig{
+      .name = "sdr-device", .policy = SDR::ThreadPolicy::Fifo, .priority = 50};
+  SDR::ThreadConfig poolConfig{.name = "sdr-pool"};
+  SDR::ThreadConfig serverConfig{.name = "rtsp-server"};
+
+  const unsigned int cpuCount = std::thread::hardware_concurrency();
+  if (cpuCount >= 2) {
+    deviceConfig.cpus = {cpuCount - 1};
+    for (unsigned int cpu = 0; cpu + 1 < cpuCount; ++cpu) {
+      poolConfig.cpus.push_back(cpu);
+    }
+    serverConfig.cpus = poolConfig.cpus;
+  }
+
+  SDR::BaseTuner::setDeviceThreadConfig(deviceConfig);
+  SDR::ThreadPool::setSharedThreadConfig(poolConfig);
+  server.setThreadConfig(serverConfig);
+}
+
+constexpr const char* Usage =
+    "Usage: turnip [--thread-pool] [--pipelining] [--rebalancing]"
+    " [--sharding] [--overload-handling]";
+
+// Graph features are off unless turned on from the command line, see
+// SDR::TunerGraphOptions
+bool parseArguments(
+    int argc,
+    const char* argv[],
+    SDR::TunerGraphOptions& graphOptions) {
+  for (int index = 1; index < argc; ++index) {
+    const std::string argument = argv[index];
+    if (argument == "--thread-pool") {
+      graphOptions.threadPool = true;
+    } else if (argument == "--pipelining") {
+      graphOptions.pipelining = true;
+    } else if (argument == "--rebalancing") {
+      graphOptions.rebalancing = true;
+    } else if (argument == "--sharding") {
+      graphOptions.sharding = true;
+    } else if (argument == "--overload-handling") {
+      graphOptions.overloadHandling = true;
+    } else {
+      std::cerr << "Unknown argument: " << argument << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
 } // namespace
 
 // TODO implement command line bells and whistles
 
 int main(int argc, const char* argv[]) {
+  SDR::TunerGraphOptions graphOptions;
+  if (!parseArguments(argc, argv, graphOptions)) {
+    std::cerr << Usage << std::endl;
+    return 1;
+  }
+  SDR::BaseTuner::setGraphOptions(graphOptions);
+
   std::cout << "Searching for devices...." << std::endl;
 
   sdrplay::api::lock();
@@ -41,9 +109,12 @@ int main(int argc, const char* argv[]) {
   std::cout << "Found device(s)" << std::endl;
   const auto device = devices.front();
   device->select();
+  // Lets clients switch modems without restarting the device
+  device->set_keep_alive(DeviceKeepAlive);
   sdrplay::api::unlock();
 
   Tuner::Server server(device.get());
+  configureThreads(server);
   server.startRunning();
 
   // TODO exit immediately if port 544 is already in use -> important for
@@ -40,6 +40,8 @@ class device_callbacks {
 
 namespace {
 
+constexpr unsigned char initial_lna_state = 4;
+
 constexpr double input_params_for_output_rate(
     double output_sample_rate,
     unsigned int* decimation,
@@ -129,6 +131,17 @@ void device::release() {
 }
 
 void device::start(double sample_rate, double freq, bool agc) {
+  cancel_idle_stop();
+  if (state_ == Running) {
+    if (sample_rate == running_sample_rate_ && agc == running_agc_) {
+      // Same settings as a fresh start, minus sdrplay_api_Uninit/Init
+      set_center_freq(freq);
+      set_lna_state(initial_lna_state);
+      return;
+    }
+    uninit();
+  }
+
   unsigned int decimation;
   sdrplay_api_If_kHzT if_type;
   const double input_rate =
@@ -136,6 +149,8 @@ void device::start(double sample_rate, double freq, bool agc) {
   const sdrplay_api_Bw_MHzT bw_type = bw_for_output_rate(sample_rate);
 
   start(input_rate, bw_type, if_type, decimation, freq, agc);
+  running_sample_rate_ = sample_rate;
+  running_agc_ = agc;
 }
 
 void device::start(
@@ -161,7 +176,7 @@ void device::start(
   tunerParams.bwType = bw_type;
   tunerParams.ifType = if_type;
   tunerParams.gain.gRdB = 50;
-  tunerParams.gain.LNAstate = 4;
+  tunerParams.gain.LNAstate = initial_lna_state;
   tunerParams.rfFreq.rfHz = freq;
 
   auto& ctrlParams = this->ctrlParams();
@@ -194,12 +209,59 @@ void device::start(
 }
 
 void device::stop() {
+  cancel_idle_stop();
+  uninit();
+}
+
+void device::stop_when_idle() {
+  cancel_idle_stop();
+  if (keep_alive_.count() == 0) {
+    uninit();
+    return;
+  }
+  if (state_ != Running) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(idle_mutex_);
+  idle_cancelled_ = false;
+  const auto deadline = std::chrono::steady_clock::now() + keep_alive_;
+  idle_thread_ = std::thread([this, deadline]() {
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    if (!idle_condition_.wait_until(
+            lock, deadline, [this] { return idle_cancelled_; })) {
+      std::cout << "Stopping idle device" << std::endl;
+      uninit();
+    }
+  });
+}
+
+void device::set_keep_alive(std::chrono::milliseconds timeout) {
+  keep_alive_ = timeout;
+}
+
+void device::uninit() {
   if (state_ == Running) {
     sdrplay_api_Uninit(handle());
     state_ = Selected;
   }
 }
 
+void device::cancel_idle_stop() {
+  std::thread thread;
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    idle_cancelled_ = true;
+    thread = std::move(idle_thread_);
+  }
+  idle_condition_.notify_all();
+  // Once joined, the idle thread has either stopped the device or left it
+  // running for us
+  if (thread.joinable()) {
+    thread.join();
+  }
+}
+
 void device::close_stream(base_stream* s) {
   std::lock_guard<std::mutex> lock(streams_mutex_);
   const auto found = streams_.find(s);
@@ -12,9 +12,12 @@
 #include <sdrplay_api.h>
 
 #include <array>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_set>
 
 namespace sdrplay {
@@ -40,6 +43,8 @@ class device final : public std::enable_shared_from_this<device> {
   void select();
   void release();
 
+  // Only retunes the device if it is still running with the same sample rate
+  // and gain mode, see stop_when_idle()
   void start(double sample_rate, double freq, bool agc);
   void start(
       double sample_rate,
@@ -50,6 +55,12 @@ class device final : public std::enable_shared_from_this<device> {
       bool agc);
   void stop();
 
+  // Stops the device unless it is started again within the keep-alive
+  // timeout, so that a tuner replacing another one does not wait for the
+  // device to restart. Stops it right away if the timeout is zero.
+  void stop_when_idle();
+  void set_keep_alive(std::chrono::milliseconds timeout);
+
   template <typename T>
   std::shared_ptr<stream<T>> open_stream();
 
@@ -74,6 +85,9 @@ class device final : public std::enable_shared_from_this<device> {
   auto& tunerParams() const;
   auto& ctrlParams() const;
 
+  void uninit();
+  void cancel_idle_stop();
+
  private:
   friend class device_callbacks;
   void rxa_callback(short* xi, short* xq, unsigned int numSamples, bool reset);
@@ -99,6 +113,13 @@ class device final : public std::enable_shared_from_this<device> {
   sdrplay_api_DeviceParamsT* params_ = nullptr;
   sdrplay_api_CallbackFnsT cbfns_;
   device_state state_ = Initialized;
+  double running_sample_rate_ = 0.0;
+  bool running_agc_ = false;
+  std::chrono::milliseconds keep_alive_{0};
+  std::thread idle_thread_;
+  bool idle_cancelled_ = false;
+  std::mutex idle_mutex_;
+  std::condition_variable idle_condition_;
   std::unordered_set<base_stream*> streams_;
   std::mutex streams_mutex_;
   std::unordered_set<device_events*> observers_;
@@ -108,6 +129,8 @@ class device final : public std::enable_shared_from_this<device> {
 template <typename T>
 inline std::shared_ptr<stream<T>> device::open_stream() {
   const auto s = std::make_shared<stream<T>>(shared_from_this());
+  // The device may be streaming already
+  std::lock_guard<std::mutex> lock(streams_mutex_);
   streams_.insert(s.get());
   return s;
 }
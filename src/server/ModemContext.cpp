@@ -106,6 +106,18 @@ std::shared_ptr<SDR::MetadataPacket> ModemContext::tryFetchMetadataPacket() {
   return tuner->tryFetchMetadataPacket();
 }
 
+void ModemContext::addMetadataSubscriber() {
+  using TunerType = SDR::TunerWithQueue<SDR::MP3Packet, SDR::MetadataPacket>;
+  const auto tuner = dynamic_cast<TunerType*>(tuner_);
+  tuner->addMetadataSubscriber();
+}
+
+void ModemContext::removeMetadataSubscriber() {
+  using TunerType = SDR::TunerWithQueue<SDR::MP3Packet, SDR::MetadataPacket>;
+  const auto tuner = dynamic_cast<TunerType*>(tuner_);
+  tuner->removeMetadataSubscriber();
+}
+
 void ModemContext::queueParamUpdate(const std::string& command) {
   if (!tuner_) {
     return;
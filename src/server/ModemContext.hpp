@@ -49,6 +49,8 @@ class ModemContext : public SDR::TunerEvents {
 
   std::shared_ptr<SDR::MP3Packet> tryFetchAudioPacket();
   std::shared_ptr<SDR::MetadataPacket> tryFetchMetadataPacket();
+  void addMetadataSubscriber();
+  void removeMetadataSubscriber();
 
   void queueParamUpdate(const std::string& command);
 
@@ -27,6 +27,9 @@ ProgramMetadataSource::ProgramMetadataSource(
 ProgramMetadataSource::~ProgramMetadataSource() {
   if (context_->tuner()) {
     context_->tuner()->removeObserver(this);
+    if (addedObserver_) {
+      context_->removeMetadataSubscriber();
+    }
   }
 
   --referenceCount;
@@ -59,6 +62,7 @@ void ProgramMetadataSource::doGetNextFrame() {
   if (!addedObserver_) {
     addedObserver_ = true;
     context_->tuner()->addObserver(this);
+    context_->addMetadataSubscriber();
   }
 
   if (context_->isTunerStopped()) {
@@ -329,6 +329,7 @@ void Server::setupServer() {
 }
 
 void Server::runner() {
+  SDR::applyThreadConfig(threadConfig_);
   setupServer();
   env_->taskScheduler().doEventLoop(&stopping_);
 }
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <easysdr/core/ThreadConfig.hpp>
+
 #include <atomic>
 #include <thread>
 
@@ -24,6 +26,11 @@ class Server {
  public:
   Server(SDRDevice* device) : device_(device) {}
 
+  // Applied to the RTSP server thread, must be called before startRunning()
+  void setThreadConfig(const SDR::ThreadConfig& config) {
+    threadConfig_ = config;
+  }
+
   void startRunning();
   void stopRunning();
 
@@ -34,6 +41,7 @@ class Server {
  private:
   SDRDevice* device_;
   std::thread thread_;
+  SDR::ThreadConfig threadConfig_;
   UsageEnvironment* env_ = nullptr;
   volatile char stopping_ = 0;
 };
@@ -47,27 +47,33 @@ AMTuner::AMTuner(
           clampFreqToDeviceMin(frequency, device),
           frequency),
       iqResample_(advancedParams.deviceSamplingFreq, bandwidth),
-      demodAM_(mode),
+      demodAM_(std::make_tuple(mode), std::make_tuple()),
       audioResample_(bandwidth, advancedParams.audioSamplingFreq),
+      audioRechunk_(MP3Encode::samplesInPacket()),
       mp3Encoder_(
           advancedParams.audioSamplingFreq,
           1,
           advancedParams.outputBitrateKbps),
       mp3Output_(*audioQueue()),
+      graphStats_(graph()),
       metadataOutput_(*metadataQueue()) {
   // Assemble graph
   graph()
       .connectQueued(sdrInput_, freqShift_)
       .connect(freqShift_, iqResample_)
       .connect(iqResample_, demodAM_)
-      .connect(demodAM_, autoGain_)
-      .connect(autoGain_, audioResample_)
+      .connect(demodAM_, audioResample_)
       .connect(audioResample_, floatToShort_)
-      .connect(floatToShort_, mp3Encoder_)
+      .connect(floatToShort_, audioRechunk_)
+      .connect(audioRechunk_, mp3Encoder_)
       .connect<MP3Encode::OUT_OUTPUT, QueueOut<MP3Packet>::IN_INPUT_VECTOR>(
           mp3Encoder_, mp3Output_)
-      .connect<SDRPlayInput::OUT_METADATA, QueueOut<MetadataPacket>::IN_INPUT>(
-          sdrInput_, metadataOutput_);
+      .connectQueued<
+          SDRPlayInput::OUT_METADATA,
+          GraphStatsMetadata::IN_INPUT>(sdrInput_, graphStats_)
+      .connect<
+          GraphStatsMetadata::OUT_OUTPUT,
+          QueueOut<MetadataPacket>::IN_INPUT>(graphStats_, metadataOutput_);
 
   // Validators
   const Graph::BindingValidator<double> centerFreqValidator =
@@ -80,6 +86,19 @@ AMTuner::AMTuner(
         return std::clamp(bandwidth, MinAMBandwidth, MaxAMBandwidth);
       };
 
+  // Gets the device thread config
+  setDeviceInput(sdrInput_);
+
+  // While overloaded, stats are only published along with metadata, and the
+  // metadata output only runs for packets carrying something
+  graph()
+      .setNodePriority(graphStats_, NodePriority::Low)
+      .setNodePriority(metadataOutput_, NodePriority::Low);
+
+  // Names in graph stats
+  mp3Output_.setName("MP3Output");
+  metadataOutput_.setName("MetadataOutput");
+
   // Bind controls
   graph()
       .bind<SDRPlayInput::CTRL_LNA_STATE>(sdrInput_, "lna_state")
@@ -90,7 +109,7 @@ AMTuner::AMTuner(
       .bind<IQResample::CTRL_TARGET_FREQ>(iqResample_, "bw", bandwidthValidator)
       .bind<AudioResample::CTRL_SOURCE_FREQ>(
           audioResample_, "bw", bandwidthValidator)
-      .bind<DemodulateAM::CTRL_MODE>(demodAM_, "mode");
+      .bind<DemodulateAM::CTRL_MODE>(demodAM_.stage<0>(), "mode");
 }
 
 } // namespace SDR
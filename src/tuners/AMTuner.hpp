@@ -9,13 +9,16 @@
 
 #include "TunerWithQueue.hpp"
 
+#include <easysdr/core/Fused.hpp>
 #include <easysdr/core/Metadata.hpp>
 #include <easysdr/core/QueueOut.hpp>
 #include <easysdr/nodes/AudioAutoGain.hpp>
 #include <easysdr/nodes/Convert.hpp>
 #include <easysdr/nodes/DemodulateAM.hpp>
 #include <easysdr/nodes/FrequencyShift.hpp>
+#include <easysdr/nodes/GraphStatsMetadata.hpp>
 #include <easysdr/nodes/MP3Encode.hpp>
+#include <easysdr/nodes/Rechunk.hpp>
 #include <easysdr/nodes/Resample.hpp>
 #include <easysdr/nodes/SDRPlayInput.hpp>
 
@@ -37,8 +40,11 @@ class AMTuner : public TunerWithQueue<MP3Packet, MetadataPacket> {
  public:
   using SDRPlayInput = SDR::SDRPlayInput<std::complex<float>>;
   using IQResample = SDR::Resample<std::complex<float>>;
+  // Demodulated audio goes through the gain control in cache-sized tiles
+  using Demodulate = SDR::Fused<DemodulateAM, AudioAutoGain>;
   using AudioResample = SDR::Resample<float>;
   using FloatToShort = SDR::Convert<float, short>;
+  using AudioRechunk = SDR::Rechunk<int16_t>;
 
   AMTuner(
       SDRDevice* device,
@@ -60,12 +66,13 @@ class AMTuner : public TunerWithQueue<MP3Packet, MetadataPacket> {
   SDRPlayInput sdrInput_;
   FrequencyShift freqShift_;
   IQResample iqResample_;
-  DemodulateAM demodAM_;
+  Demodulate demodAM_;
   AudioResample audioResample_;
-  AudioAutoGain autoGain_;
   FloatToShort floatToShort_;
+  AudioRechunk audioRechunk_;
   MP3Encode mp3Encoder_;
   QueueOut<MP3Packet> mp3Output_;
+  GraphStatsMetadata graphStats_;
   QueueOut<MetadataPacket> metadataOutput_;
 };
 
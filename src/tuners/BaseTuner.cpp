@@ -7,8 +7,14 @@
 
 #include "BaseTuner.hpp"
 
+#include <iostream>
+
 namespace SDR {
 
+ThreadConfig BaseTuner::deviceThreadConfig_;
+TunerGraphOptions BaseTuner::graphOptions_;
+std::unordered_map<std::type_index, GraphStats> BaseTuner::measuredStats_;
+
 BaseTuner::~BaseTuner() {
   stopRunning();
   graph().unbindAll();
@@ -19,6 +25,29 @@ void BaseTuner::startRunning() {
   if (running_) {
     return;
   }
+  if (deviceInput_) {
+    graph_.setThreadConfig(*deviceInput_, deviceThreadConfig_);
+  }
+  graph_.setExecutionMode(
+      graphOptions_.threadPool ? Graph::ExecutionMode::ThreadPool
+                               : Graph::ExecutionMode::ThreadPerSubgraph);
+  if (graphOptions_.pipelining) {
+    PartitionOptions options;
+    const auto measured = measuredStats_.find(typeid(*this));
+    if (measured != measuredStats_.end()) {
+      options.measured = &measured->second;
+    }
+    graph_.partition(options);
+  }
+  if (graphOptions_.rebalancing) {
+    graph_.setRebalancing(RebalanceOptions{});
+  }
+  if (graphOptions_.sharding) {
+    graph_.setSharding(ShardOptions{});
+  }
+  if (graphOptions_.overloadHandling) {
+    graph_.setOverloadHandling(OverloadOptions{});
+  }
   graph_.startRunning();
   running_ = true;
   notifyObservers([this](TunerEvents* observer) { observer->onStarted(this); });
@@ -30,11 +59,20 @@ void BaseTuner::stopRunning() {
     return;
   }
   graph_.stopRunning();
+  measuredStats_[typeid(*this)] = graph_.stats();
   running_ = false;
   notifyObservers([this](TunerEvents* observer) { observer->onStopped(this); });
   std::cout << "Tuner stopped" << std::endl;
 }
 
+void BaseTuner::setDeviceThreadConfig(const ThreadConfig& config) {
+  deviceThreadConfig_ = config;
+}
+
+void BaseTuner::setGraphOptions(const TunerGraphOptions& options) {
+  graphOptions_ = options;
+}
+
 void BaseTuner::postControlUpdates(const TunerParams& params) {
   auto updates = params.toAnyMap();
   graph().postUpdates(std::move(updates));
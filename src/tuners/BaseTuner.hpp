@@ -13,11 +13,34 @@
 
 #include <functional>
 #include <list>
+#include <typeindex>
+#include <unordered_map>
 
 namespace SDR {
 
 class BaseTuner;
 
+// Graph features enabled in tuners started afterwards, see
+// BaseTuner::setGraphOptions(). All of them are off by default, so every
+// subgraph runs on a thread of its own as a single stage.
+struct TunerGraphOptions {
+  // Runs the subgraphs fed by a queue on the shared thread pool instead of
+  // spawning a thread for every stage
+  bool threadPool = false;
+  // Splits the subgraphs fed by a queue into pipeline stages by the costs
+  // measured in the previous run, see Graph::partition()
+  bool pipelining = false;
+  // Moves nodes between pipeline stages as demodulator and decoder costs
+  // shift with the signal and the controls, needs threadPool and pipelining
+  bool rebalancing = false;
+  // Splits large IQ blocks of per-sample conversions and demodulation
+  // across the pool workers
+  bool sharding = false;
+  // Lets metadata and stats yield to the audio path when the CPU falls
+  // behind
+  bool overloadHandling = false;
+};
+
 class TunerEvents {
  public:
   virtual void onStarted(BaseTuner* tuner) {}
@@ -46,19 +69,41 @@ class BaseTuner {
   virtual unsigned int audioSamplingRate() const = 0;
   virtual unsigned int outputBitrateKbps() const = 0;
 
+  // Applied to the subgraph reading from the SDR device in every tuner
+  // started afterwards
+  static void setDeviceThreadConfig(const ThreadConfig& config);
+
+  static void setGraphOptions(const TunerGraphOptions& options);
+
  protected:
   void notifyObservers(std::function<void(TunerEvents*)> lambda);
 
+  // Node reading from the SDR device, see setDeviceThreadConfig(). Tuners
+  // connect all of its outputs through queues, so that nothing else runs on
+  // the device thread.
+  void setDeviceInput(const BaseNode& node);
+
  private:
   std::list<TunerEvents*> observers_;
   bool running_ = false;
   SDR::Graph graph_;
+  const BaseNode* deviceInput_ = nullptr;
+  static ThreadConfig deviceThreadConfig_;
+  static TunerGraphOptions graphOptions_;
+  // Stats of the last run of every tuner type, tuners of the same type are
+  // assembled the same way and split into stages by the costs measured in
+  // the previous one, see Graph::partition()
+  static std::unordered_map<std::type_index, GraphStats> measuredStats_;
 };
 
 inline bool BaseTuner::isRunning() const {
   return running_;
 }
 
+inline void BaseTuner::setDeviceInput(const BaseNode& node) {
+  deviceInput_ = &node;
+}
+
 inline const SDR::Graph& BaseTuner::graph() const {
   return graph_;
 }
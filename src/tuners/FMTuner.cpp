@@ -35,11 +35,13 @@ FMTuner::FMTuner(
       audioResample_(bandwidth, advancedParams.audioSamplingFreq),
       stereoResample_(bandwidth, advancedParams.audioSamplingFreq),
       muxFMS_(advancedParams.audioSamplingFreq),
+      audioRechunk_(MP3Encode::samplesInPacket() * (mono ? 1 : 2)),
       mp3Encoder_(
           advancedParams.audioSamplingFreq,
           mono ? 1 : 2,
           advancedParams.outputBitrateKbps),
       mp3Output_(*audioQueue()),
+      graphStats_(graph()),
       metadataOutput_(*metadataQueue()) {
   if (frequency < device->min_center_freq()) {
     throw std::runtime_error("frequency too low");
@@ -65,11 +67,31 @@ FMTuner::FMTuner(
   }
 
   graph()
-      .connect(floatToShort_, mp3Encoder_)
+      .connect(floatToShort_, audioRechunk_)
+      .connect(audioRechunk_, mp3Encoder_)
       .connect<MP3Encode::OUT_OUTPUT, QueueOut<MP3Packet>::IN_INPUT_VECTOR>(
           mp3Encoder_, mp3Output_)
-      .connect<SDRPlayInput::OUT_METADATA, QueueOut<MetadataPacket>::IN_INPUT>(
-          sdrInput_, metadataOutput_);
+      .connectQueued<
+          SDRPlayInput::OUT_METADATA,
+          GraphStatsMetadata::IN_INPUT>(sdrInput_, graphStats_)
+      .connect<
+          GraphStatsMetadata::OUT_OUTPUT,
+          QueueOut<MetadataPacket>::IN_INPUT>(graphStats_, metadataOutput_);
+
+  // Gets the device thread config
+  setDeviceInput(sdrInput_);
+
+  // While overloaded, stats are only published along with metadata, and the
+  // metadata output only runs for packets carrying something
+  graph()
+      .setNodePriority(graphStats_, NodePriority::Low)
+      .setNodePriority(metadataOutput_, NodePriority::Low);
+
+  // Names in graph stats
+  audioResample_.setName("AudioResample");
+  stereoResample_.setName("StereoResample");
+  mp3Output_.setName("MP3Output");
+  metadataOutput_.setName("MetadataOutput");
 
   // Bind controls
   graph()
@@ -16,7 +16,9 @@
 #include <easysdr/nodes/DemodulateFM.hpp>
 #include <easysdr/nodes/DemodulateFMS.hpp>
 #include <easysdr/nodes/FrequencyShift.hpp>
+#include <easysdr/nodes/GraphStatsMetadata.hpp>
 #include <easysdr/nodes/MP3Encode.hpp>
+#include <easysdr/nodes/Rechunk.hpp>
 #include <easysdr/nodes/MuxFMS.hpp>
 #include <easysdr/nodes/Resample.hpp>
 #include <easysdr/nodes/SDRPlayInput.hpp>
@@ -41,6 +43,7 @@ class FMTuner : public TunerWithQueue<MP3Packet, MetadataPacket> {
   using IQResample = SDR::Resample<std::complex<float>>;
   using AudioResample = SDR::Resample<float>;
   using FloatToShort = SDR::Convert<float, short>;
+  using AudioRechunk = SDR::Rechunk<int16_t>;
 
   FMTuner(
       SDRDevice* device,
@@ -68,8 +71,10 @@ class FMTuner : public TunerWithQueue<MP3Packet, MetadataPacket> {
   MuxFMS muxFMS_;
   AudioAutoGain autoGain_;
   FloatToShort floatToShort_;
+  AudioRechunk audioRechunk_;
   MP3Encode mp3Encoder_;
   QueueOut<MP3Packet> mp3Output_;
+  GraphStatsMetadata graphStats_;
   QueueOut<MetadataPacket> metadataOutput_;
 };
 
@@ -28,23 +28,47 @@ HDRadioTuner::HDRadioTuner(
         advancedParams /*= HDRadioTunerAdvancedParams{}*/)
     : sdrInput_(device, deviceSamplingRate(), frequency),
       nrsc5Decoder_(program),
+      audioRechunk_(MP3Encode::samplesInPacket() * 2),
       mp3Encoder_(audioSamplingRate(), 2, advancedParams.outputBitrateKbps),
       mp3Output_(*audioQueue()),
+      graphStats_(graph()),
       sdrMetadataOutput_(*metadataQueue()),
       nrsc5MetadataOutput_(*metadataQueue()) {
   // Assemble graph
   graph()
       .connectQueued(sdrInput_, nrsc5Decoder_)
-      .connect(nrsc5Decoder_, mp3Encoder_)
-      .connect<DecodeNRSC5::OUT_DISCONTINUITY, MP3Encode::IN_DISCONTINUITY>(
-          nrsc5Decoder_, mp3Encoder_)
+      .connect(nrsc5Decoder_, audioRechunk_)
+      .connect(audioRechunk_, mp3Encoder_)
+      .connect<DecodeNRSC5::OUT_DISCONTINUITY, AudioRechunk::IN_DISCONTINUITY>(
+          nrsc5Decoder_, audioRechunk_)
+      .connect<AudioRechunk::OUT_DISCONTINUITY, MP3Encode::IN_DISCONTINUITY>(
+          audioRechunk_, mp3Encoder_)
       .connect<MP3Encode::OUT_OUTPUT, QueueOut<MP3Packet>::IN_INPUT_VECTOR>(
           mp3Encoder_, mp3Output_)
-      .connect<SDRPlayInput::OUT_METADATA, QueueOut<MetadataPacket>::IN_INPUT>(
-          sdrInput_, sdrMetadataOutput_)
+      .connectQueued<
+          SDRPlayInput::OUT_METADATA,
+          GraphStatsMetadata::IN_INPUT>(sdrInput_, graphStats_)
+      .connect<
+          GraphStatsMetadata::OUT_OUTPUT,
+          QueueOut<MetadataPacket>::IN_INPUT>(graphStats_, sdrMetadataOutput_)
       .connect<DecodeNRSC5::OUT_METADATA, QueueOut<MetadataPacket>::IN_INPUT>(
           nrsc5Decoder_, nrsc5MetadataOutput_);
 
+  // Gets the device thread config
+  setDeviceInput(sdrInput_);
+
+  // While overloaded, stats are only published along with metadata, and the
+  // metadata outputs only run for packets carrying something
+  graph()
+      .setNodePriority(graphStats_, NodePriority::Low)
+      .setNodePriority(sdrMetadataOutput_, NodePriority::Low)
+      .setNodePriority(nrsc5MetadataOutput_, NodePriority::Low);
+
+  // Names in graph stats
+  mp3Output_.setName("MP3Output");
+  sdrMetadataOutput_.setName("SDRMetadataOutput");
+  nrsc5MetadataOutput_.setName("NRSC5MetadataOutput");
+
   // Bind controls
   graph()
       .bind<DecodeNRSC5::CTRL_PROGRAM>(nrsc5Decoder_, "program")
@@ -10,7 +10,9 @@
 #include "TunerWithQueue.hpp"
 
 #include <easysdr/nodes/DecodeNRSC5.hpp>
+#include <easysdr/nodes/GraphStatsMetadata.hpp>
 #include <easysdr/nodes/MP3Encode.hpp>
+#include <easysdr/nodes/Rechunk.hpp>
 #include <easysdr/nodes/SDRPlayInput.hpp>
 
 namespace sdrplay {
@@ -29,6 +31,7 @@ class HDRadioTuner : public TunerWithQueue<MP3Packet, MetadataPacket> {
  public:
   using SDRPlayInput = SDR::SDRPlayInput<int16_t>;
   using DecodeNRSC5 = SDR::DecodeNRSC5<int16_t>;
+  using AudioRechunk = SDR::Rechunk<int16_t>;
 
   HDRadioTuner(
       SDRDevice* device,
@@ -53,8 +56,10 @@ class HDRadioTuner : public TunerWithQueue<MP3Packet, MetadataPacket> {
  private:
   SDRPlayInput sdrInput_;
   DecodeNRSC5 nrsc5Decoder_;
+  AudioRechunk audioRechunk_;
   MP3Encode mp3Encoder_;
   QueueOut<MP3Packet> mp3Output_;
+  GraphStatsMetadata graphStats_;
   QueueOut<MetadataPacket> sdrMetadataOutput_;
   QueueOut<MetadataPacket> nrsc5MetadataOutput_;
 };
@@ -11,6 +11,8 @@
 
 #include <easysdr/core/Queue.hpp>
 
+#include <iostream>
+
 namespace SDR {
 
 template <class AudioPacket, class MetadataPacket>
@@ -21,6 +23,8 @@ class TunerWithQueue : public BaseTuner, public BaseQueueObserver {
         metadataQueue_(std::make_shared<MetadataQueue>(256)) {
     audioQueue()->addObserver(this);
     metadataQueue()->addObserver(this);
+    // Nodes producing metadata only run while somebody reads it
+    metadataQueue()->setSubscribed(false);
   }
 
   virtual ~TunerWithQueue() {
@@ -60,9 +64,32 @@ class TunerWithQueue : public BaseTuner, public BaseQueueObserver {
     return metadataQueue()->try_pop();
   }
 
+  // Readers of program metadata, see Graph::refreshDemand(). Calls are
+  // paired and made by the server thread.
+  void addMetadataSubscriber() {
+    setMetadataSubscribers(metadataSubscribers_ + 1);
+  }
+
+  void removeMetadataSubscriber() {
+    if (metadataSubscribers_ == 0) {
+      std::cerr << "Error: metadata subscriber removed without being added"
+                << std::endl;
+      return;
+    }
+    setMetadataSubscribers(metadataSubscribers_ - 1);
+  }
+
+ private:
+  void setMetadataSubscribers(size_t count) {
+    metadataSubscribers_ = count;
+    metadataQueue()->setSubscribed(count != 0);
+    graph().refreshDemand();
+  }
+
  private:
   std::shared_ptr<AudioQueue> audioQueue_;
   std::shared_ptr<MetadataQueue> metadataQueue_;
+  size_t metadataSubscribers_ = 0;
 };
 
 } // namespace SDR